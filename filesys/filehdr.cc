@@ -3,12 +3,16 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as in UNIX: a fixed
+//	size table of pointers to the first few data sectors, followed
+//	by a single, a double and a triple indirect block for the rest
+//	of the file.  The table size is chosen so that the file header
+//	will be just big enough to fit in one disk sector.
+//
+//	Index blocks are written when the file is created, and never
+//	change afterwards (files have a fixed size), so an open file
+//	header can keep a few of them in memory without worrying
+//	about them going stale.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,10 +31,50 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// IndexSpan
+// 	Return the number of data sectors that can be reached through
+//	an index block at "level" (1 for a single indirect block, 2
+//	for a double indirect block, and so on).
+//----------------------------------------------------------------------
+
+static int
+IndexSpan(int level)
+{
+    int span = 1;
+
+    for (int i = 0; i < level; i++)
+	span *= PointersPerSector;
+    return span;
+}
+
+//----------------------------------------------------------------------
+// IndexBlocks
+// 	Return the number of index blocks needed by an index block at
+//	"level" that maps "count" data sectors, counting itself.
+//----------------------------------------------------------------------
+
+static int
+IndexBlocks(int level, int count)
+{
+    int blocks = 1;
+    int span;
+
+    if (count <= 0)
+	return 0;
+    if (level == 1)
+	return 1;
+    span = IndexSpan(level - 1);
+    for (; count > 0; count -= span)
+	blocks += IndexBlocks(level - 1, min(count, span));
+    return blocks;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+//	Allocate data blocks for the file out of the map of free disk blocks,
+//	plus whatever indirect blocks are needed to reach them.
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
@@ -41,16 +85,70 @@
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
 { 
+    int count, needed;
+
     numBytes = fileSize;
     numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    singleIndirect = doubleIndirect = tripleIndirect = -1;
+    ClearIndexCache();
+    if (numSectors > MaxFileSector)
+	return FALSE;		// too big, even with indirect blocks
+
+    count = numSectors - NumDirect;	// sectors beyond the direct ones
+    needed = numSectors + IndexBlocks(1, min(count, IndexSpan(1)))
+	+ IndexBlocks(2, min(count - IndexSpan(1), IndexSpan(2)))
+	+ IndexBlocks(3, count - IndexSpan(1) - IndexSpan(2));
+    if (freeMap->NumClear() < needed)
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
+    for (int i = 0; i < numSectors && i < NumDirect; i++)
 	dataSectors[i] = freeMap->Find();
+    if (count > 0)
+	singleIndirect = AllocateIndex(freeMap, 1, min(count, IndexSpan(1)));
+    count -= IndexSpan(1);
+    if (count > 0)
+	doubleIndirect = AllocateIndex(freeMap, 2, min(count, IndexSpan(2)));
+    count -= IndexSpan(2);
+    if (count > 0)
+	tripleIndirect = AllocateIndex(freeMap, 3, count);
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::AllocateIndex
+// 	Allocate an index block at "level", along with the data blocks
+//	(and, above level 1, the lower index blocks) it points to, and
+//	write it to disk.  Return the sector holding the index block.
+//	The caller has already checked that there is enough free space.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"level" is 1 for a block of pointers to data sectors, 2 for a
+//		block of pointers to level 1 blocks, and so on
+//	"count" is the number of data sectors to be reached through
+//		this block
+//----------------------------------------------------------------------
+
+int
+FileHeader::AllocateIndex(BitMap *freeMap, int level, int count)
+{
+    int pointers[PointersPerSector];
+    int sector = freeMap->Find();
+    int span = IndexSpan(level - 1);
+    int i;
+
+    ASSERT(sector != -1 && count <= IndexSpan(level));
+    for (i = 0; i < PointersPerSector; i++, count -= span) {
+	if (count <= 0)
+	    pointers[i] = -1;
+	else if (level == 1)
+	    pointers[i] = freeMap->Find();
+	else
+	    pointers[i] = AllocateIndex(freeMap, level - 1, min(count, span));
+    }
+    synchDisk->WriteSector(sector, (char *) pointers);
+    return sector;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
 // 	De-allocate all the space allocated for data blocks for this file.
@@ -61,10 +159,52 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
+    int count;
+
+    for (int i = 0; i < numSectors && i < NumDirect; i++) {
 	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
 	freeMap->Clear((int) dataSectors[i]);
     }
+    count = numSectors - NumDirect;
+    if (count > 0)
+	DeallocateIndex(freeMap, singleIndirect, 1, 
+				min(count, IndexSpan(1)));
+    count -= IndexSpan(1);
+    if (count > 0)
+	DeallocateIndex(freeMap, doubleIndirect, 2, 
+				min(count, IndexSpan(2)));
+    count -= IndexSpan(2);
+    if (count > 0)
+	DeallocateIndex(freeMap, tripleIndirect, 3, count);
+    ClearIndexCache();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::DeallocateIndex
+// 	De-allocate an index block, and everything reachable from it.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"sector" is the sector holding the index block
+//	"level" and "count" are as for AllocateIndex
+//----------------------------------------------------------------------
+
+void
+FileHeader::DeallocateIndex(BitMap *freeMap, int sector, int level, 
+				int count)
+{
+    int pointers[PointersPerSector];
+    int span = IndexSpan(level - 1);
+
+    synchDisk->ReadSector(sector, (char *) pointers);
+    for (int i = 0; i < PointersPerSector && count > 0; i++, count -= span) {
+	if (level == 1) {
+	    ASSERT(freeMap->Test(pointers[i]));  // ought to be marked!
+	    freeMap->Clear(pointers[i]);
+	} else
+	    DeallocateIndex(freeMap, pointers[i], level - 1, min(count, span));
+    }
+    ASSERT(freeMap->Test(sector));
+    freeMap->Clear(sector);
 }
 
 //----------------------------------------------------------------------
@@ -77,7 +217,8 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    synchDisk->ReadSector(sector, (char *)this);	// on-disk part only
+    ClearIndexCache();
 }
 
 //----------------------------------------------------------------------
@@ -106,7 +247,63 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int i = offset / SectorSize;
+    int sector;
+
+    if (i < NumDirect)
+	return(dataSectors[i]);
+    i -= NumDirect;
+    if (i < IndexSpan(1))
+	return IndexEntry(singleIndirect, i, 0);
+    i -= IndexSpan(1);
+    if (i < IndexSpan(2)) {
+	sector = IndexEntry(doubleIndirect, i / IndexSpan(1), 0);
+	return IndexEntry(sector, i % IndexSpan(1), 1);
+    }
+    i -= IndexSpan(2);
+    sector = IndexEntry(tripleIndirect, i / IndexSpan(2), 0);
+    sector = IndexEntry(sector, (i / IndexSpan(1)) % IndexSpan(1), 1);
+    return IndexEntry(sector, i % IndexSpan(1), 2);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::IndexEntry
+// 	Return one pointer out of an index block, reading the block
+//	into the header's small cache of index blocks if it is not
+//	there already.  The cache holds one block for each depth of
+//	the tree, so while a file is read sequentially every index
+//	block on the path to the current data sector stays cached,
+//	and each one is read from disk only once.
+//
+//	"sector" is the sector holding the index block
+//	"which" is the pointer wanted
+//	"depth" is how far the block is below the file header (0 for
+//		the blocks the header points to directly)
+//----------------------------------------------------------------------
+
+int
+FileHeader::IndexEntry(int sector, int which, int depth)
+{
+    ASSERT(sector >= 0 && which >= 0 && which < PointersPerSector);
+    ASSERT(depth >= 0 && depth < IndexCacheSize);
+    if (cacheSector[depth] != sector) {
+	DEBUG('f', "Reading index block %d at depth %d\n", sector, depth);
+	synchDisk->ReadSector(sector, (char *) cacheBlock[depth]);
+	cacheSector[depth] = sector;
+    }
+    return cacheBlock[depth][which];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ClearIndexCache
+// 	Empty the cache of index blocks, when the header is (re)initialized.
+//----------------------------------------------------------------------
+
+void
+FileHeader::ClearIndexCache()
+{
+    for (int depth = 0; depth < IndexCacheSize; depth++)
+	cacheSector[depth] = -1;
 }
 
 //----------------------------------------------------------------------
@@ -134,10 +331,12 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
-    printf("\nFile contents:\n");
+	printf("%d ", ByteToSector(i * SectorSize));
+    printf("\nIndex blocks: %d %d %d\n", singleIndirect, doubleIndirect,
+						tripleIndirect);
+    printf("File contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+	synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,19 +17,33 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define PointersPerSector (SectorSize / (int) sizeof(int))
+#define NumDirect 	((SectorSize - 5 * (int) sizeof(int)) / (int) sizeof(int))
+#define MaxFileSector	(NumDirect + PointersPerSector \
+			 + PointersPerSector * PointersPerSector \
+			 + PointersPerSector * PointersPerSector \
+			   * PointersPerSector)
+#define MaxFileSize 	(MaxFileSector * SectorSize)
+
+#define IndexCacheSize	3	// index blocks remembered per open header,
+				// one for each depth of the tree
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as in UNIX: a table of pointers to the
+// first NumDirect data blocks, followed by the sector numbers of a
+// single, a double, and a triple indirect block.  An indirect block
+// is a sector full of pointers, either to data blocks or to further
+// indirect blocks.  This lets a file grow to the size of the disk.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the on-disk part of this data structure (everything
+// up to and including tripleIndirect) to be the same size as one disk
+// sector.  The in-memory part caches the indirect blocks most
+// recently used by ByteToSector, so that reading a large file
+// sequentially does not fetch the same index sector again for
+// every data sector.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -59,8 +73,30 @@ class FileHeader {
   private:
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int dataSectors[NumDirect];		// Disk sector numbers for the first
+					// NumDirect data blocks in the file
+    int singleIndirect;			// Sector of pointers to data blocks
+    int doubleIndirect;			// Sector of pointers to single
+					// indirect blocks
+    int tripleIndirect;			// Sector of pointers to double
+					// indirect blocks
+
+    // The rest is only kept in memory, never written to disk.
+    int cacheSector[IndexCacheSize];	// Which index sector is cached at
+					// each depth, -1 if none
+    int cacheBlock[IndexCacheSize][PointersPerSector];
+					// The contents of that index sector
+
+    void ClearIndexCache();		// Forget all cached index blocks
+    int IndexEntry(int sector, int which, int depth);
+					// Return pointer "which" of the
+					// index block in "sector"
+    int AllocateIndex(BitMap *freeMap, int level, int count);
+					// Allocate an index block mapping
+					// "count" data blocks
+    void DeallocateIndex(BitMap *freeMap, int sector, int level, 
+			int count);	// Free an index block and everything
+					// it points to
 };
 
 #endif // FILEHDR_H
@@ -121,7 +121,7 @@ FileWrite()
 
     printf("Sequential write of %d byte file, in %d byte chunks\n", 
 	FileSize, ContentSize);
-    if (!fileSystem->Create(FileName, 0)) {
+    if (!fileSystem->Create(FileName, FileSize)) {
       printf("Perf test: can't create %s\n", FileName);
       return;
     }
@@ -172,10 +172,19 @@ FileRead()
 void
 PerformanceTest()
 {
+    int reads, writes, start;
+
     printf("Starting file system performance test:\n");
     stats->Print();
+    writes = stats->numDiskWrites;
     FileWrite();
+    synchDisk->Sync();		// so that the writes are counted here
+    printf("Write phase: %d disk writes\n", stats->numDiskWrites - writes);
+    reads = stats->numDiskReads;
+    start = stats->totalTicks;
     FileRead();
+    printf("Read phase: %d disk reads, %d ticks\n", 
+	stats->numDiskReads - reads, stats->totalTicks - start);
     if (!fileSystem->Remove(FileName)) {
       printf("Perf test: unable to remove %s\n", FileName);
       return;
@@ -183,3 +192,88 @@ PerformanceTest()
     stats->Print();
 }
 
+// Parameters of the disk scheduling benchmark
+#define DiskThreads	8		// # of threads reading at once
+#define DiskRounds	50		// reads each one does
+
+static int diskTicks[DiskThreads * DiskRounds];	// how long each read took
+static Semaphore *diskDone;		// signalled as each thread finishes
+
+//----------------------------------------------------------------------
+// DiskThread
+// 	Read DiskRounds random sectors, one after another, recording how 
+//	long each read takes to complete.
+//
+//	"which" identifies the thread
+//----------------------------------------------------------------------
+
+static void
+DiskThread(int which)
+{
+    char data[SectorSize];
+    int start;
+
+    for (int i = 0; i < DiskRounds; i++) {
+	start = stats->totalTicks;
+	synchDisk->ReadSector(Random() % NumSectors, data);
+	diskTicks[which * DiskRounds + i] = stats->totalTicks - start;
+    }
+    diskDone->V();
+}
+
+//----------------------------------------------------------------------
+// DiskSchedRun
+// 	Run DiskThreads threads reading at random, with the disk scheduled
+//	by "policy", and report the average and 99th percentile time for 
+//	a read to complete.
+//----------------------------------------------------------------------
+
+static void
+DiskSchedRun(DiskSchedPolicy policy, char *name)
+{
+    int n = DiskThreads * DiskRounds;
+    int i, j, t, total = 0, start = stats->totalTicks;
+    Thread *thread;
+
+    synchDisk->SetPolicy(policy);
+    diskDone = new Semaphore("disk test done", 0);
+    for (i = 0; i < DiskThreads; i++) {
+	thread = new Thread("disk test");
+	thread->Fork(DiskThread, (void *) i);
+    }
+    for (i = 0; i < DiskThreads; i++)
+	diskDone->P();
+    delete diskDone;
+
+    for (i = 1; i < n; i++) {		// sort the times, to find the 99th 
+	t = diskTicks[i];		// percentile
+	for (j = i; (j > 0) && (diskTicks[j - 1] > t); j--)
+	    diskTicks[j] = diskTicks[j - 1];
+	diskTicks[j] = t;
+    }
+    for (i = 0; i < n; i++)
+	total += diskTicks[i];
+    printf("%s: %d reads in %d ticks; average %d ticks, 99th percentile %d\n",
+	name, n, stats->totalTicks - start, total / n, diskTicks[n * 99 / 100]);
+}
+
+//----------------------------------------------------------------------
+// DiskSchedTest
+// 	Compare the disk scheduling policies, for random reads by many
+//	threads at once.  Run it with -cachesize 0, so that every read 
+//	goes to the disk.  Only reads are done, so the file system isn't
+//	harmed.
+//----------------------------------------------------------------------
+
+void
+DiskSchedTest()
+{
+    DiskSchedPolicy policy = synchDisk->getPolicy();
+
+    printf("Disk scheduling test: %d threads, %d random reads each\n", 
+	DiskThreads, DiskRounds);
+    DiskSchedRun(FifoDiskScheduling, "FIFO");
+    DiskSchedRun(SstfDiskScheduling, "SSTF");
+    DiskSchedRun(CLookDiskScheduling, "C-LOOK");
+    synchDisk->SetPolicy(policy);
+}
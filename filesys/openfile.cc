@@ -7,6 +7,12 @@
 //	Also as in UNIX, for convenience, we keep the file header in
 //	memory while the file is open.
 //
+//	While a file is being read sequentially, we read ahead: the 
+//	sectors after the ones being read are put in the buffer cache 
+//	before they are asked for, by the disk's read-ahead thread.  The
+//	further the file has been read sequentially, the further ahead we
+//	read, up to "maxReadAhead" sectors; any other access stops it.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -31,7 +37,11 @@ OpenFile::OpenFile(int sector)
 { 
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    lastRead = -1;
+    aheadTo = 0;
+    window = 0;
 }
 
 //----------------------------------------------------------------------
@@ -140,6 +150,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
     delete [] buf;
+    ReadAhead(firstSector, lastSector);
     return numBytes;
 }
 
@@ -185,6 +196,35 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called after sectors "firstSector" to "lastSector" of the file 
+//	have been read.  If they carry on from the last ones read (or 
+//	re-read the last one, as small reads do), the file is being read
+//	sequentially: double the read-ahead window, and start reading in
+//	the sectors it now covers.  Otherwise, close the window.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int firstSector, int lastSector)
+{
+    int numSectors = divRoundUp(hdr->FileLength(), SectorSize);
+
+    if ((firstSector == lastRead) || (firstSector == lastRead + 1)) {
+	if (lastSector > lastRead)		// onto a new sector
+	    window = min(max(2 * window, 1), maxReadAhead);
+    } else {
+	window = 0;
+	aheadTo = lastSector + 1;
+    }
+    lastRead = lastSector;
+    if (aheadTo <= lastSector)
+	aheadTo = lastSector + 1;
+    for (; (aheadTo <= lastSector + window) && (aheadTo < numSectors);
+		aheadTo++)
+	synchDisk->ReadAhead(hdr->ByteToSector(aheadTo * SectorSize));
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Length
 // 	Return the number of bytes in the file.
@@ -52,6 +52,7 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+    int FileId() { return FileIdentity(file); }
     
   private:
     int file;
@@ -59,6 +60,9 @@ class OpenFile {
 };
 
 #else // FILESYS
+#define MaxReadAhead	8	// most sectors to read ahead of a 
+				// sequential reader, unless told otherwise
+
 class FileHeader;
 
 class OpenFile {
@@ -85,10 +89,22 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+    int FileId() { return hdrSector; }	// Return a number identifying the
+					// file, the same for every open of
+					// it: the sector of its header
     
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// Where the header is on disk
     int seekPosition;			// Current position within the file
+    int lastRead;			// the last sector of the file read
+    int aheadTo;			// the next sector to read ahead
+    int window;				// how far to read ahead; grows while
+					// the file is read sequentially
+
+    void ReadAhead(int firstSector, int lastSector);
+					// Having read these sectors of the
+					// file, read ahead if it looks worth it
 };
 
 #endif // FILESYS
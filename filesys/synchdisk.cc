@@ -5,10 +5,19 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	The physical disk can only handle one operation at a time, so
+//	requests made while it is busy wait in a queue.  Each time the 
+//	disk finishes a request, the interrupt handler wakes up the thread
+//	that made it, and sends the disk the next one, chosen by the 
+//	disk scheduling policy.
+//
+//	In front of the disk is a buffer cache of recently used sectors,
+//	written back when they are evicted, least recently used first, or
+//	when we are asked to Sync.  A read-ahead thread reads sectors into
+//	the cache before they are asked for, and a flusher thread writes
+//	modified sectors back every so often.  A lock protects the cache,
+//	but it isn't held while waiting for the disk; instead, an entry 
+//	being read or written is marked busy, and anyone who needs it waits.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +25,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -31,39 +41,97 @@ DiskRequestDone (int arg)
     disk->RequestDone();
 }
 
+//----------------------------------------------------------------------
+// ReadAheadThread
+// 	The read-ahead thread.  Need this to be a C routine, for Fork.
+//----------------------------------------------------------------------
+
+static void
+ReadAheadThread (int arg)
+{
+    SynchDisk* disk = (SynchDisk *)arg;
+
+    disk->ReadAheadLoop();
+}
+
+//----------------------------------------------------------------------
+// FlusherThread
+// 	The flusher thread.  Need this to be a C routine, for Fork.
+//----------------------------------------------------------------------
+
+static void
+FlusherThread (int arg)
+{
+    SynchDisk* disk = (SynchDisk *)arg;
+
+    disk->FlushLoop();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
-//	initializing the physical disk.
+//	initializing the physical disk.  The buffer cache starts out empty.
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"cacheSectors" -- the # of sectors the buffer cache can hold
+//	"schedPolicy" -- the order to send waiting requests to the disk
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, int cacheSectors, DiskSchedPolicy schedPolicy)
 {
-    semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
+    ioDone = new Condition("synch disk I/O done");
+    dirtied = new Condition("synch disk dirtied");
     disk = new Disk(name, DiskRequestDone, (int) this);
+    policy = schedPolicy;
+    active = NULL;
+    requests = new List;
+    headSector = 0;
+    numEntries = cacheSectors;
+    cache = new CacheEntry[numEntries];
+    for (int i = 0; i < numEntries; i++) {
+	cache[i].sector = -1;
+	cache[i].dirty = FALSE;
+	cache[i].pending = FALSE;
+	cache[i].busy = FALSE;
+	cache[i].lastUse = 0;
+    }
+    useCount = 0;
+    numDirty = 0;
+    readAheadList = new SynchList;
+    if (numEntries > 0) {
+	Thread *t = new Thread("read-ahead");
+
+	t->Fork(ReadAheadThread, (void *) this);
+	t = new Thread("flusher");
+	t->Fork(FlusherThread, (void *) this);
+    }
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  Anything not yet written back by Sync is lost.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
+    delete readAheadList;
+    delete [] cache;
+    delete requests;
     delete disk;
+    delete dirtied;
+    delete ioDone;
     delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read.  If the sector is in the cache, we
+//	don't have to wait for the disk; otherwise, it is read into the
+//	cache, in place of the least recently used sector.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -72,16 +140,47 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    CacheEntry *entry;
+    bool missed = FALSE;
+
+    if (numEntries == 0) {
+	DiskIO(sectorNumber, data, FALSE);
+	return;
+    }
+    lock->Acquire();
+    for (;;) {
+	entry = Lookup(sectorNumber);
+	if (entry == NULL) {
+	    entry = Victim();		// (others may run meanwhile)
+	    if (Lookup(sectorNumber) != NULL)
+		continue;		// someone else read it in
+	    entry->sector = sectorNumber;
+	    entry->pending = TRUE;
+	}
+	if (entry->busy)		// wait for whoever is reading it
+	    ioDone->Wait(lock);
+	else if (entry->pending) {	// not there, or the read-ahead 
+	    missed = TRUE;		// thread hasn't got to it yet
+	    entry->pending = FALSE;
+	    EntryIO(entry, FALSE);
+	} else
+	    break;
+    }
+    if (missed)
+	stats->numCacheMisses++;
+    else
+	stats->numCacheHits++;
+    entry->lastUse = ++useCount;
+    bcopy(entry->data, data, SectorSize);
     lock->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+//	after the data has been written -- into the cache, which writes it
+//	back to the disk later.  Since the whole sector is written, there
+//	is no need to read it in first.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -90,20 +189,458 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    CacheEntry *entry;
+    bool missed = FALSE;
+
+    if (numEntries == 0) {
+	DiskIO(sectorNumber, data, TRUE);
+	return;
+    }
+    lock->Acquire();
+    for (;;) {
+	entry = Lookup(sectorNumber);
+	if (entry == NULL) {
+	    entry = Victim();		// (others may run meanwhile)
+	    if (Lookup(sectorNumber) != NULL)
+		continue;		// someone else read it in
+	    entry->sector = sectorNumber;
+	    missed = TRUE;
+	}
+	if (!entry->busy)
+	    break;
+	ioDone->Wait(lock);		// don't change it during I/O
+    }
+    if (missed)
+	stats->numCacheMisses++;
+    else
+	stats->numCacheHits++;
+    entry->lastUse = ++useCount;
+    if (!entry->dirty) {
+	entry->dirty = TRUE;
+	if (numDirty++ == 0)		// the flusher has work to do
+	    dirtied->Signal(lock);
+    }
+    entry->pending = FALSE;		// no need to read it in now
+    bcopy(data, entry->data, SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Sync
+// 	Write every modified sector in the cache back to the disk, so that
+//	the disk is up to date.  The sectors stay in the cache.
+//
+//	Sectors someone else is writing back already are done when no 
+//	entry is busy any more.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Sync()
+{
+    lock->Acquire();
+    Flush();
+    for (int i = 0; i < numEntries; i++)
+	while (cache[i].busy)
+	    ioDone->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Arrange for a sector to be read into the cache, without waiting 
+//	for it: set aside an entry for it, and leave the read-ahead 
+//	thread to read it in.
+//
+//	Reading ahead is only worth it if it doesn't cost the caller
+//	anything, so nothing is done if the sector is already in the cache,
+//	or if every entry would have to be written back to make room.
+//
+//	"sectorNumber" -- the disk sector that will be read soon
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber)
+{
+    CacheEntry *entry;
+
+    if (numEntries == 0)
+	return;
+    lock->Acquire();
+    if (Lookup(sectorNumber) == NULL) {
+	entry = CleanVictim();
+	if (entry != NULL) {
+	    DEBUG('f', "Reading ahead sector %d\n", sectorNumber);
+	    entry->sector = sectorNumber;
+	    entry->pending = TRUE;
+	    entry->lastUse = ++useCount;
+	    readAheadList->Append((void *)entry);
+	}
+    }
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::ReadAheadLoop
+// 	The read-ahead thread: read in each entry set aside by ReadAhead,
+//	in turn.  Never returns.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAheadLoop()
+{
+    for (;;)
+	ReadPending((CacheEntry *)readAheadList->Remove());
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FlushLoop
+// 	The flusher thread: once a sector has been modified, wait 
+//	FlushInterval ticks (so that it can be modified some more, and its
+//	neighbours as well), and then write back everything modified.  
+//	Never returns.
+//
+//	While nothing is modified, we wait on a condition rather than 
+//	the alarm, so that Nachos can tell when it has nothing left to do.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FlushLoop()
+{
+    for (;;) {
+	lock->Acquire();
+	while (numDirty == 0)
+	    dirtied->Wait(lock);
+	lock->Release();
+	alarmClock->WaitUntil(FlushInterval);
+	lock->Acquire();
+	stats->numFlushes++;
+	Flush();
+	lock->Release();
+    }
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the disk
+//	request to finish, and start the next request, if any.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    DiskRequest *request = active;
+
+    ASSERT(request != NULL);
+    if (--(*request->outstanding) == 0)
+	scheduler->ReadyToRun(request->waiter);
+    active = NULL;
+    request = NextRequest();
+    if (request != NULL)
+	StartRequest(request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Lookup
+// 	Return the cache entry holding "sectorNumber", or NULL if it 
+//	isn't in the cache.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::Lookup(int sectorNumber)
+{
+    for (int i = 0; i < numEntries; i++)
+	if (cache[i].sector == sectorNumber)
+	    return &cache[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Victim
+// 	Return an empty cache entry, to hold a new sector: one that was
+//	empty already, or else the least recently used.  If it has been 
+//	modified, write it back first.  Entries that are busy are left 
+//	alone; if they all are, wait.
+//
+//	Writing back lets go of "lock", and the entry may be used again
+//	meanwhile, so then we have to start again.  The caller has to 
+//	check that no one else has read in the sector it wants, as well.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::Victim()
+{
+    CacheEntry *victim;
+
+    for (;;) {
+	victim = NULL;
+	for (int i = 0; i < numEntries; i++) {
+	    if (cache[i].busy)
+		continue;
+	    if (cache[i].sector == -1) {
+		victim = &cache[i];
+		break;
+	    }
+	    if ((victim == NULL) || (cache[i].lastUse < victim->lastUse))
+		victim = &cache[i];
+	}
+	if (victim == NULL)
+	    ioDone->Wait(lock);
+	else if (victim->dirty) {
+	    DEBUG('f', "Writing back sector %d from the buffer cache\n", 
+		    victim->sector);
+	    victim->dirty = FALSE;
+	    numDirty--;
+	    stats->numCacheWritebacks++;
+	    EntryIO(victim, TRUE);
+	} else
+	    break;
+    }
+    victim->sector = -1;
+    victim->pending = FALSE;		// if it was set aside for read-ahead,
+    return victim;			// that is cancelled
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::CleanVictim
+// 	Like Victim, but without writing anything back or waiting: return
+//	the least recently used entry that is neither modified nor busy, 
+//	or NULL if there isn't one.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::CleanVictim()
+{
+    CacheEntry *victim = NULL;
+
+    for (int i = 0; i < numEntries; i++) {
+	if (cache[i].dirty || cache[i].pending || cache[i].busy)
+	    continue;
+	if (cache[i].sector == -1)
+	    return &cache[i];
+	if ((victim == NULL) || (cache[i].lastUse < victim->lastUse))
+	    victim = &cache[i];
+    }
+    if (victim != NULL)
+	victim->sector = -1;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadPending
+// 	Read in an entry set aside by ReadAhead -- unless it has been
+//	read or written since, or given to another sector.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadPending(CacheEntry *entry)
+{
+    lock->Acquire();
+    if (entry->pending && !entry->busy) {
+	entry->pending = FALSE;
+	stats->numReadAheads++;
+	EntryIO(entry, FALSE);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::EntryIO
+// 	Read or write the sector a cache entry holds.  The entry is busy
+//	meanwhile, and we let go of "lock", so that others can use the
+//	cache -- and the disk.  When we are done, wake up anyone waiting
+//	for the entry.  The caller must hold "lock".
+//----------------------------------------------------------------------
+
+void
+SynchDisk::EntryIO(CacheEntry *entry, bool writing)
+{
+    ASSERT(lock->isHeldByCurrentThread() && !entry->busy);
+    entry->busy = TRUE;
+    lock->Release();
+    DiskIO(entry->sector, entry->data, writing);
+    lock->Acquire();
+    entry->busy = FALSE;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write back every modified entry that isn't busy.  They are sorted
+//	by sector, and queued all at once, so that each run of consecutive
+//	sectors goes to the disk back to back: the disk starts on the next
+//	sector just as it finishes the last, rather than a whole rotation
+//	later.  The caller must hold "lock", which we let go of while the
+//	disk writes.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    CacheEntry **dirty = new CacheEntry *[numEntries];
+    DiskRequest *batch;
+    CacheEntry *entry;
+    int i, j, n = 0;
+
+    ASSERT(lock->isHeldByCurrentThread());
+    for (i = 0; i < numEntries; i++) {	// sort the modified entries
+	entry = &cache[i];
+	if (!entry->dirty || entry->busy)
+	    continue;
+	for (j = n; (j > 0) && (dirty[j - 1]->sector > entry->sector); j--)
+	    dirty[j] = dirty[j - 1];
+	dirty[j] = entry;
+	n++;
+    }
+    if (n == 0) {
+	delete [] dirty;
+	return;
+    }
+
+    batch = new DiskRequest[n];
+    for (i = 0; i < n; i++) {
+	entry = dirty[i];
+	if ((i == 0) || (entry->sector != dirty[i - 1]->sector + 1))
+	    stats->numFlushRuns++;
+	entry->dirty = FALSE;
+	entry->busy = TRUE;
+	batch[i].sector = entry->sector;
+	batch[i].data = entry->data;
+	batch[i].writing = TRUE;
+    }
+    numDirty -= n;
+    stats->numCacheWritebacks += n;
+    DEBUG('f', "Flushing %d sectors, from %d to %d\n", n, dirty[0]->sector,
+	    dirty[n - 1]->sector);
+
+    lock->Release();
+    DiskIO(batch, n);
+    lock->Acquire();
+    for (i = 0; i < n; i++)
+	dirty[i]->busy = FALSE;
+    ioDone->Broadcast(lock);
+    delete [] batch;
+    delete [] dirty;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::DiskIO
+// 	Read (write) a sector from (to) the disk itself, and wait for the
+//	request to finish.  If the disk is busy, the request waits in the 
+//	queue until the disk scheduling policy chooses it.
+//
+//	Or, queue a whole "batch" of "n" requests (with their sectors,
+//	data and direction filled in), and wait until they are all done.
+//
+//	The requests belong to us; we don't return until the disk 
+//	interrupt handler has finished with them.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::DiskIO(int sectorNumber, char* data, bool writing)
+{
+    DiskRequest request;
+
+    request.sector = sectorNumber;
+    request.data = data;
+    request.writing = writing;
+    DiskIO(&request, 1);
+}
+
+void
+SynchDisk::DiskIO(DiskRequest *batch, int n)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int outstanding = n;
+
+    for (int i = 0; i < n; i++) {
+	batch[i].waiter = currentThread;
+	batch[i].outstanding = &outstanding;
+	batch[i].link.item = (void *) &batch[i];
+	if (active == NULL)
+	    StartRequest(&batch[i]);
+	else
+	    requests->AppendLink(&batch[i].link);
+    }
+    while (outstanding > 0)
+	currentThread->Sleep(BlockedOnDisk);	// wait for interrupt
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartRequest
+// 	Send a request to the disk, which must be idle.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartRequest(DiskRequest *request)
+{
+    ASSERT(active == NULL);
+    active = request;
+    headSector = request->sector;
+    if (request->writing)
+	disk->WriteRequest(request->sector, request->data);
+    else
+	disk->ReadRequest(request->sector, request->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::NextRequest
+// 	Take the request the disk should do next off the queue, and 
+//	return it; NULL if there are none.
+//
+//	With SSTF, that is the one the disk can seek to fastest, as 
+//	Disk::TimeToSeek works it out.  With C-LOOK, it is the first one
+//	we come to, moving the head inwards (to higher-numbered tracks) 
+//	from where it is, or else the outermost.  Ties go to the request 
+//	that has been waiting longest.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::NextRequest()
+{
+    DiskRequest *request, *best = NULL;
+    int n = requests->NumInList();
+    int key, bestKey = 0, rotation, track;
+    int headTrack = headSector / SectorsPerTrack;
+
+    if ((n == 0) || (policy == FifoDiskScheduling))
+	return (DiskRequest *)requests->Remove();
+
+    for (int i = 0; i < n; i++) {	// look at each request, leaving the
+	request = (DiskRequest *)requests->Remove();	// list in order
+	if (policy == SstfDiskScheduling)
+	    key = disk->TimeToSeek(request->sector, &rotation);
+	else {
+	    track = request->sector / SectorsPerTrack;
+	    key = ((track - headTrack + NumTracks) % NumTracks) 
+			* SectorsPerTrack + (request->sector % SectorsPerTrack);
+	}
+	if ((best == NULL) || (key < bestKey)) {
+	    best = request;
+	    bestKey = key;
+	}
+	requests->AppendLink(&request->link);
+    }
+    requests->Remove((void *)best);
+    return best;
+}
+
+//----------------------------------------------------------------------
+// DiskSchedulingNamed
+// 	Return the disk scheduling policy with the given name, as given 
+//	on the command line.
+//----------------------------------------------------------------------
+
+DiskSchedPolicy
+DiskSchedulingNamed(char *name)
+{
+    if (!strcmp(name, "fifo"))
+	return FifoDiskScheduling;
+    else if (!strcmp(name, "sstf"))
+	return SstfDiskScheduling;
+    else if (!strcmp(name, "clook"))
+	return CLookDiskScheduling;
+    printf("Unknown disk scheduling policy \"%s\"\n", name);
+    ASSERT(FALSE);
+    return FifoDiskScheduling;
 }
@@ -13,6 +13,51 @@
 
 #include "disk.h"
 #include "synch.h"
+#include "synchlist.h"
+
+#define CacheSectors	64	// sectors in the buffer cache, unless
+				// told otherwise (with -cachesize)
+#define FlushInterval	20000	// how long a modified sector may stay in
+				// the cache before it is written back
+
+// The orders in which we can send waiting requests to the disk:
+//
+//	FIFO -- in the order they were made
+//	SSTF -- shortest seek time first: the request on the nearest 
+//		track to the disk head
+//	C-LOOK -- sweep the head from the outside in, serving requests
+//		as it reaches their tracks; when there are none further 
+//		in, go back to the outermost request
+
+enum DiskSchedPolicy { FifoDiskScheduling, SstfDiskScheduling, 
+		       CLookDiskScheduling };
+
+// The following class defines one sector's worth of the buffer cache.
+
+class CacheEntry {
+  public:
+    int sector;			// the disk sector it holds; -1 if none
+    bool dirty;			// modified since it was read or written?
+    bool pending;		// set aside for read-ahead, but not yet 
+				// read in?
+    bool busy;			// being read or written right now?
+    int lastUse;		// when it was last used, for LRU
+    char data[SectorSize];	// the contents of the sector
+};
+
+// The following class defines a request to read or write a sector,
+// while it waits for the disk.
+
+class DiskRequest {
+  public:
+    int sector;			// the disk sector to read or write
+    char *data;			// where the data goes, or comes from
+    bool writing;		// a write?
+    Thread *waiter;		// the thread waiting for it
+    int *outstanding;		// # of the thread's requests not done
+				// yet; it is woken when this reaches 0
+    ListElement link;		// to put it on the queue of requests
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -23,31 +68,103 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Any number of threads can make requests at once: while
+// the disk is busy, requests wait in a queue, and when it is done, the
+// next one is chosen according to the disk scheduling policy.
+//
+// Recently used sectors are kept in a buffer cache, so that reading
+// them again doesn't have to wait for the disk.  Writes only go into
+// the cache; a modified sector is written back to the disk when it is
+// evicted (the least recently used sector goes first), by a flusher
+// thread within FlushInterval ticks, or by Sync.  Sync must be called 
+// before Nachos halts, or the latest changes are lost.
+//
+// The flusher and Sync write back every modified sector at once, in
+// order, so that runs of consecutive sectors are written one straight
+// after another, without waiting for the disk to come round again.
+//
+// Sectors can also be read into the cache ahead of time, by a 
+// read-ahead thread, so that whoever asked for them can get on with 
+// something else meanwhile.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
-					// by initializing the raw Disk.
+    SynchDisk(char* name, int cacheSectors, DiskSchedPolicy policy);
+    					// Initialize a synchronous disk,
+					// by initializing the raw Disk, with
+					// a cache of "cacheSectors" sectors
+					// (none at all if 0), and scheduling
+					// requests according to "policy"
     ~SynchDisk();			// De-allocate the synch disk data
     
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+					// or written (into the cache, if
+					// there is one).  On a cache miss, 
+					// these queue a request for the disk
+					// and wait until it is done.
     void WriteSector(int sectorNumber, char* data);
+    void Sync();			// Write every modified sector in the
+					// cache back to the disk
+    void ReadAhead(int sectorNumber);	// Start reading a sector into the
+					// cache, without waiting for it
+    void ReadAheadLoop();		// Read in the sectors for ReadAhead
+					// (the read-ahead thread; never 
+					// returns)
+    void FlushLoop();			// Write back modified sectors every
+					// so often (the flusher thread; never
+					// returns)
     
+    DiskSchedPolicy getPolicy() { return policy; }
+    void SetPolicy(DiskSchedPolicy newPolicy) { policy = newPolicy; }
+					// Change the scheduling policy (eg, 
+					// to compare them)
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskSchedPolicy policy;		// which waiting request goes next
+    DiskRequest *active;		// the request the disk is doing; 
+					// NULL if it is idle
+    List *requests;			// requests waiting for the disk
+    int headSector;			// the sector of the last request sent
+					// to the disk, where its head is
+    Lock *lock;		  		// protects the cache
+    Condition *ioDone;			// signalled when a cache entry is no
+					// longer busy
+    Condition *dirtied;			// signalled when a sector is modified,
+					// if none were before
+    CacheEntry *cache;			// the buffer cache
+    int numEntries;			// # of sectors it holds
+    int useCount;			// counter for "lastUse"
+    int numDirty;			// # of entries modified
+    SynchList *readAheadList;		// entries for the read-ahead thread
+					// to read in
+
+    CacheEntry *Lookup(int sectorNumber);
+					// Find a sector in the cache
+    CacheEntry *Victim();		// Make room for another sector
+    CacheEntry *CleanVictim();		// ... without writing one back
+    void ReadPending(CacheEntry *entry);// Read in a sector set aside for
+					// read-ahead
+    void EntryIO(CacheEntry *entry, bool writing);
+					// Read or write a cache entry, 
+					// letting go of "lock" meanwhile
+    void Flush();			// Write back every modified entry
+    void DiskIO(int sectorNumber, char* data, bool writing);
+					// Queue a request, and wait for it
+    void DiskIO(DiskRequest *batch, int n);
+					// ... or queue several at once
+    void StartRequest(DiskRequest *request);
+					// Send a request to the disk
+    DiskRequest *NextRequest();		// Take the request to do next off the
+					// queue, according to "policy"
 };
 
+extern DiskSchedPolicy DiskSchedulingNamed(char *name);
+					// Parse "fifo", "sstf" or "clook"
+					// (for -disksched)
+
 #endif // SYNCHDISK_H
@@ -74,6 +74,8 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int TimeToSeek(int newSector, int *rotate); // time to get to the new track
+					// (used for disk scheduling, too)
 
   private:
     int fileno;				// UNIX file number for simulated disk 
@@ -85,7 +87,6 @@ class Disk {
     int bufferInit;			// When the track buffer started 
 					// being loaded
 
-    int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
 };
@@ -14,6 +14,11 @@
 //		a user instruction is executed
 //		there is nothing in the ready queue
 //
+//	User instruction ticks are batched up (see OneUserTick), but
+//	only while no interrupt could be due, and they are always added
+//	in before the time is looked at; so interrupts happen at exactly
+//	the same simulated times as they would without batching.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -24,11 +29,17 @@
 #include "interrupt.h"
 #include "system.h"
 
+#define MaxTickBatch	10000	// most ticks to batch up when there are
+				// no pending interrupts at all
+#define InitialQueueSize 64	// room for this many pending interrupts,
+				// to start with
+
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
-static char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+static char *intTypeNames[] = { "timer", "alarm", "disk", "console write", 
+			"console read", "elevator", "network send", 
+			"network recv"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -48,6 +59,188 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
     arg = param;
     when = time;
     type = kind;
+    seq = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::InterruptQueue
+// 	Initialize an empty queue of pending interrupts.
+//----------------------------------------------------------------------
+
+InterruptQueue::InterruptQueue()
+{
+    maxPending = InitialQueueSize;
+    heap = new PendingInterrupt *[maxPending];
+    numPending = 0;
+    nextSeq = 0;
+    freeList = NULL;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::~InterruptQueue
+// 	De-allocate the queue, along with the records of any interrupts 
+//	still pending, and the free records.
+//----------------------------------------------------------------------
+
+InterruptQueue::~InterruptQueue()
+{
+    PendingInterrupt *rec;
+
+    for (int i = 0; i < numPending; i++)
+	delete heap[i];
+    while (freeList != NULL) {
+	rec = freeList;
+	freeList = rec->next;
+	delete rec;
+    }
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Insert
+// 	Add an interrupt to the queue, reusing a free record if there
+//	is one.  If the heap is full, double its size.
+//
+//	"handler", "arg", "when", "type" -- as for PendingInterrupt
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Insert(VoidFunctionPtr handler, int arg, int when, 
+			IntType type)
+{
+    PendingInterrupt *rec, **bigger;
+
+    if (freeList != NULL) {
+	rec = freeList;
+	freeList = rec->next;
+	rec->handler = handler;
+	rec->arg = arg;
+	rec->when = when;
+	rec->type = type;
+    } else
+	rec = new PendingInterrupt(handler, arg, when, type);
+    rec->seq = nextSeq++;
+    rec->next = NULL;
+
+    if (numPending == maxPending) {
+	bigger = new PendingInterrupt *[maxPending * 2];
+	for (int i = 0; i < numPending; i++)
+	    bigger[i] = heap[i];
+	delete [] heap;
+	heap = bigger;
+	maxPending *= 2;
+    }
+    heap[numPending] = rec;
+    SiftUp(numPending++);
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::RemoveFirst
+// 	Take the interrupt due first off the queue, and return it.  The 
+//	caller gives the record back with Free, once it is done with it.
+//
+//	Returns NULL if nothing is pending.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+InterruptQueue::RemoveFirst()
+{
+    PendingInterrupt *first;
+
+    if (numPending == 0)
+	return NULL;
+    first = heap[0];
+    heap[0] = heap[--numPending];
+    if (numPending > 0)
+	SiftDown(0);
+    return first;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Free
+// 	Put the record of an interrupt that has fired on the free list.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Free(PendingInterrupt *rec)
+{
+    rec->next = freeList;
+    freeList = rec;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::SiftUp
+// 	Move heap[i] up towards the root until its parent is due before it.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::SiftUp(int i)
+{
+    PendingInterrupt *rec = heap[i];
+    int parent;
+
+    while (i > 0) {
+	parent = (i - 1) / 2;
+	if (!Before(rec, heap[parent]))
+	    break;
+	heap[i] = heap[parent];
+	i = parent;
+    }
+    heap[i] = rec;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::SiftDown
+// 	Move heap[i] down away from the root until both its children are 
+//	due after it.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::SiftDown(int i)
+{
+    PendingInterrupt *rec = heap[i];
+    int child;
+
+    for (;;) {
+	child = 2 * i + 1;
+	if (child >= numPending)
+	    break;
+	if ((child + 1 < numPending) && Before(heap[child + 1], heap[child]))
+	    child++;
+	if (!Before(heap[child], rec))
+	    break;
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = rec;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Mapcar
+// 	Apply a function to each pending interrupt, in the order they
+//	are due.  The heap isn't in that order, so sort a copy of it 
+//	first; this is only used for debugging, so it needn't be fast.
+//
+//	"func" is the procedure to apply; it is passed the PendingInterrupt
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Mapcar(VoidFunctionPtr func)
+{
+    PendingInterrupt **sorted = new PendingInterrupt *[numPending + 1];
+    PendingInterrupt *rec;
+    int i, j;
+
+    for (i = 0; i < numPending; i++) {		// insertion sort
+	rec = heap[i];
+	for (j = i; (j > 0) && Before(rec, sorted[j - 1]); j--)
+	    sorted[j] = sorted[j - 1];
+	sorted[j] = rec;
+    }
+    for (i = 0; i < numPending; i++)
+	(*func)((int) sorted[i]);
+    delete [] sorted;
 }
 
 //----------------------------------------------------------------------
@@ -60,10 +253,14 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new InterruptQueue();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    batchTicks = !DebugIsEnabled('i')	// tracing prints every tick,
+		    && (numCpus == 1);	// and CPUs take turns by the tick
+    quietTicks = 0;
+    batchedTicks = 0;
 }
 
 //----------------------------------------------------------------------
@@ -73,8 +270,6 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete (PendingInterrupt *)pending->Remove();
     delete pending;
 }
 
@@ -151,15 +346,22 @@ void
 Interrupt::OneTick()
 {
     MachineStatus old = status;
+    int ticks;
+
+    FlushTicks();			// catch up on any batched ticks
 
 // advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
+	ticks = SystemTick;
 	stats->systemTicks += SystemTick;
     } else {					// USER_PROGRAM
-	stats->totalTicks += UserTick;
+	ticks = UserTick;
 	stats->userTicks += UserTick;
     }
+    if (numCpus > 1)			// only the current CPU's clock moves
+	currentCpu->Advance(ticks);
+    else
+	stats->totalTicks += ticks;
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
 // check any pending interrupts are now ready to fire
@@ -176,6 +378,55 @@ Interrupt::OneTick()
 	currentThread->Yield();
 	status = old;
     }
+    if (numCpus > 1) {			// maybe let another CPU have a turn
+	ChangeLevel(IntOn, IntOff);
+	status = SystemMode;
+	CpuTick();
+	status = old;
+	ChangeLevel(IntOff, IntOn);
+    }
+    ComputeQuietTicks();		// how long until we need to check again?
+}
+
+//----------------------------------------------------------------------
+// Interrupt::FlushTicks
+// 	Add the user instruction ticks counted by OneUserTick into 
+//	simulated time.  Called before anything that looks at the time,
+//	or could schedule a new interrupt: OneTick, an exception or
+//	system call, Schedule, Idle, and Halt.
+//----------------------------------------------------------------------
+
+void
+Interrupt::FlushTicks()
+{
+    if (batchedTicks == 0)
+	return;
+    stats->totalTicks += batchedTicks * UserTick;
+    stats->userTicks += batchedTicks * UserTick;
+    batchedTicks = 0;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::ComputeQuietTicks
+// 	Work out how many user instructions can be run before the first 
+//	pending interrupt is due, so that OneUserTick doesn't need to call 
+//	OneTick until then.  The tick that reaches the interrupt's time 
+//	must go through OneTick.
+//----------------------------------------------------------------------
+
+void
+Interrupt::ComputeQuietTicks()
+{
+    PendingInterrupt *first = pending->First();
+
+    if (!batchTicks)
+	quietTicks = 0;
+    else if (first == NULL)
+	quietTicks = MaxTickBatch;
+    else if (first->when > stats->totalTicks)
+	quietTicks = (first->when - stats->totalTicks - 1) / UserTick;
+    else
+	quietTicks = 0;
 }
 
 //----------------------------------------------------------------------
@@ -211,6 +462,8 @@ void
 Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
+    FlushTicks();
+    quietTicks = 0;			// the clock is about to jump ahead
     status = IdleMode;
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
@@ -218,6 +471,8 @@ Interrupt::Idle()
         yieldOnReturn = FALSE;		// since there's nothing in the
 					// ready queue, the yield is automatic
         status = SystemMode;
+	if (numCpus > 1)		// every CPU was idle until now
+	    currentCpu->CatchUp();
 	return;				// return in case there's now
 					// a runnable thread
     }
@@ -241,6 +496,7 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    FlushTicks();
     stats->Print();
     Cleanup();     // Never returns.
 }
@@ -250,7 +506,7 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on the queue of pending interrupts.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -264,14 +520,17 @@ Interrupt::Halt()
 void
 Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
 {
-    int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
+    int when;
+
+    FlushTicks();			// so that "now" is right
+    when = stats->totalTicks + fromNow;
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    pending->Insert(handler, arg, when, type);
+    ComputeQuietTicks();		// it may be due before the others
 }
 
 //----------------------------------------------------------------------
@@ -291,33 +550,29 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    int when;
+    PendingInterrupt *toOccur;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+    toOccur = pending->First();
 
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
 
-    if (advanceClock && when > stats->totalTicks) {	// advance the clock
-	stats->idleTicks += (when - stats->totalTicks);
-	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
+    if (advanceClock && toOccur->when > stats->totalTicks) {
+	stats->idleTicks += (toOccur->when - stats->totalTicks);
+	stats->totalTicks = toOccur->when;	// advance the clock
+    } else if (toOccur->when > stats->totalTicks)	// not time yet
 	return FALSE;
-    }
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+				&& (pending->NumPending() == 1))
 	 return FALSE;
-    }
 
+    pending->RemoveFirst();
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
 #ifdef USER_PROGRAM
@@ -331,7 +586,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    pending->Free(toOccur);
     return TRUE;
 }
 
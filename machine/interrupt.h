@@ -14,6 +14,13 @@
 //		a user instruction is executed
 //		there is nothing in the ready queue
 //
+//	Since most user instructions can't possibly cause an interrupt, 
+//	we don't check the pending interrupts after every one of them:
+//	we work out how many instructions it will be until the first 
+//	pending interrupt is due, and just count ticks until then.  The
+//	count is added into the statistics before anyone can see it,
+//	so the simulated time at which everything happens is unchanged.
+//
 //	As a result, unlike real hardware, interrupts (and thus time-slice 
 //	context switches) cannot occur anywhere in the code where interrupts
 //	are enabled, but rather only at those places in the code where 
@@ -47,9 +54,9 @@ enum IntStatus { IntOff, IntOn };
 enum MachineStatus {IdleMode, SystemMode, UserMode};
 
 // IntType records which hardware device generated an interrupt.
-// In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
-enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
+// In Nachos, we support a hardware timer device, a one-shot alarm,
+// a disk, a console display and keyboard, and a network.
+enum IntType { TimerInt, AlarmInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				ElevatorInt, NetworkSendInt, NetworkRecvInt};
 
 // The following class defines an interrupt that is scheduled
@@ -67,6 +74,51 @@ class PendingInterrupt {
     int arg;                    // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int seq;			// Order in which it was scheduled, to break
+				// ties between interrupts due at once
+    PendingInterrupt *next;	// Next free record, once it has fired
+};
+
+// The following class defines the queue of interrupts scheduled to
+// occur in the future, in order of when they are due; interrupts due
+// at the same time come out in the order they were scheduled.
+//
+// The queue is a binary heap, so scheduling an interrupt or taking
+// the next one off takes O(log n) time, rather than O(n) for a sorted
+// list.  Records for interrupts that have fired are kept on a free 
+// list and reused, rather than allocating new ones every time.
+
+class InterruptQueue {
+  public:
+    InterruptQueue();			// initialize an empty queue
+    ~InterruptQueue();			// de-allocate the queue and records
+
+    void Insert(VoidFunctionPtr handler, int arg, int when, IntType type);
+					// Add an interrupt to the queue
+    PendingInterrupt *First() { return (numPending > 0) ? heap[0] : NULL; }
+					// The next interrupt due, if any
+    PendingInterrupt *RemoveFirst();	// Take the next interrupt off the
+					// queue; return it with Free
+    void Free(PendingInterrupt *rec);	// Recycle an interrupt record
+    int NumPending() { return numPending; }
+    bool IsEmpty() { return (numPending == 0); }
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every pending
+					// interrupt, in order
+
+  private:
+    PendingInterrupt **heap;		// heap[0] is due first; the children
+					// of heap[i] are heap[2i+1], heap[2i+2]
+    int numPending;			// # of interrupts in the heap
+    int maxPending;			// size of the heap array
+    int nextSeq;			// to number interrupts as scheduled
+    PendingInterrupt *freeList;		// records to reuse
+
+    bool Before(PendingInterrupt *a, PendingInterrupt *b) {
+	return (a->when < b->when) || ((a->when == b->when) 
+					&& (a->seq < b->seq)); }
+    void SiftUp(int i);			// Restore the heap order, after 
+    void SiftDown(int i);		// heap[i] was added or replaced
 };
 
 // The following class defines the data structures for the simulation
@@ -96,6 +148,8 @@ class Interrupt {
 					// from an interrupt handler
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
+    bool InHandler() { return inHandler; }	// running an interrupt
+						// handler?
     void setStatus(MachineStatus st) { status = st; }
 
     void DumpState();			// Print interrupt state
@@ -112,14 +166,29 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
 
+    void OneUserTick() {		// Advance simulated time by one user
+	if (quietTicks > 0) {		// instruction.  If no interrupt can be
+	    quietTicks--;		// due yet, just count the tick; 
+	    batchedTicks++;		// otherwise, do the real thing.
+	} else
+	    OneTick();
+    }
+    void FlushTicks();			// Add any ticks counted by OneUserTick
+					// into the statistics.  Must be done
+					// before anyone looks at the time.
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    InterruptQueue *pending;	// the interrupts scheduled to occur
+				// in the future
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    bool batchTicks;		// TRUE if OneUserTick may skip OneTick
+    int quietTicks;		// # of user ticks before the next interrupt
+				// could possibly be due
+    int batchedTicks;		// # of user ticks not yet added into stats
 
     // these functions are internal to the interrupt simulation code
 
@@ -128,6 +197,8 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
+    void ComputeQuietTicks();		// Set quietTicks from the first
+					// pending interrupt
 };
 
 #endif // INTERRRUPT_H
@@ -9,6 +9,7 @@
 
 #include "copyright.h"
 #include "machine.h"
+#include "mipsblock.h"
 #include "system.h"
 
 // Textual names of the exceptions that can be generated by user program
@@ -61,17 +62,22 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
     tlb = NULL;
+    tlbSize = 0;
+    tlbPolicy = NULL;
     pageTable = NULL;
-#endif
+#ifdef USE_TLB
+    ConfigureTLB(TLBSize, TLBSize, TLBFifo);
+#endif				// else use linear page table
+    pageTableSize = 0;
 
     singleStep = debug;
+    decodeCache = NULL;
+    decodeValid = NULL;
+    pageDecoded = NULL;
+    blockCache = NULL;
+    transCacheOn = !DebugIsEnabled('a');
+    FlushTranslationCache();
     CheckEndian();
 }
 
@@ -83,8 +89,182 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    if (tlb != NULL) {
         delete [] tlb;
+	delete tlbPolicy;
+    }
+    if (decodeCache != NULL) {
+	delete [] decodeCache;
+	delete [] decodeValid;
+	delete [] pageDecoded;
+    }
+    if (blockCache != NULL)
+	delete blockCache;
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableDecodeCache
+// 	Turn on the decoded instruction cache.  There is one entry for 
+//	every word of physical memory, so that once an instruction has 
+//	been fetched and decoded, running it again only costs the address 
+//	translation.  Entries are keyed by physical address, so changes 
+//	to the page table or TLB don't make them stale; only changes to
+//	the contents of memory do.
+//----------------------------------------------------------------------
+
+void
+Machine::EnableDecodeCache()
+{
+    int i;
+
+    if (decodeCache != NULL)
+	return;
+    decodeCache = new Instruction[MemorySize / 4];
+    decodeValid = new bool[MemorySize / 4];
+    pageDecoded = new bool[NumPhysPages];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeValid[i] = FALSE;
+    for (i = 0; i < NumPhysPages; i++)
+	pageDecoded[i] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableBlockCache
+// 	Turn on the basic block cache: from now on, Machine::Run 
+//	simulates user programs a block at a time (see mipsblock.cc).
+//	The decode cache is not needed as well, since each block holds
+//	its own decoded instructions.
+//----------------------------------------------------------------------
+
+void
+Machine::EnableBlockCache()
+{
+    if (blockCache == NULL)
+	blockCache = new BlockCache;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodePage
+// 	Throw away any decoded instructions and basic blocks from physical
+//	page "physPage", because the contents of the page have changed.  
+//	Called on every user store, so the common case (nothing decoded 
+//	on the page) has to be cheap.
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodePage(int physPage)
+{
+    if (blockCache != NULL)
+	blockCache->InvalidatePage(physPage);
+    if (decodeCache == NULL || !pageDecoded[physPage])
+	return;
+    bool *valid = &decodeValid[physPage * (PageSize / 4)];
+    for (int i = 0; i < PageSize / 4; i++)
+	valid[i] = FALSE;
+    pageDecoded[physPage] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushDecodeCache
+// 	Throw away every decoded instruction, eg, after the kernel
+//	has loaded a new program into memory.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushDecodeCache()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	InvalidateDecodePage(i);
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslationCache
+// 	Forget every translation remembered by Machine::Translate.  
+//	Translate notices for itself when the page table is replaced,
+//	and re-checks a remembered entry every time it is used; but the 
+//	kernel should still call this after loading the TLB or changing
+//	page tables, so that the simulator never picks a different entry
+//	than the hardware would.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslationCache()
+{
+    for (int i = 0; i < TransCacheSize; i++) {
+	readCache[i] = NULL;
+	writeCache[i] = NULL;
+    }
+    cachedPageTable = pageTable;
+    cachedPageTableSize = pageTableSize;
+}
+
+//----------------------------------------------------------------------
+// Machine::ConfigureTLB
+// 	Replace the TLB with an empty one of a different size or 
+//	organization.  Only makes sense at startup, or if the kernel 
+//	is prepared to reload the TLB from scratch.
+//
+//	"size" -- the # of entries in the TLB
+//	"ways" -- the # of entries in each set; "size" means the TLB is 
+//		fully associative, 1 means it is direct-mapped
+//	"policy" -- how to pick a TLB entry to replace
+//----------------------------------------------------------------------
+
+void
+Machine::ConfigureTLB(int size, int ways, TLBReplacement policy)
+{
+    ASSERT((size >= MinTLBSize) && (size <= MaxTLBSize));
+    ASSERT((ways > 0) && (ways <= size) && ((size % ways) == 0));
+    if (tlb != NULL) {
+	delete [] tlb;
+	delete tlbPolicy;
+    }
+    tlbSize = size;
+    tlbWays = ways;
+    tlbSets = size / ways;
+    tlb = new TranslationEntry[size];
+    for (int i = 0; i < size; i++)
+	tlb[i].valid = FALSE;
+    tlbPolicy = new TLBPolicy(policy, size, ways);
+    FlushTranslationCache();
+    DEBUG('a', "TLB: %d entries, %d sets of %d\n", size, tlbSets, ways);
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBSlotFor
+// 	Return the TLB entry that the kernel should use, to load the
+//	translation for virtual page "vpn".  The entry has to be in the 
+//	set that the hardware will search for "vpn"; if every entry in
+//	the set is in use, the replacement policy picks one to evict.
+//
+//	The caller is responsible for saving the use and dirty bits of
+//	the entry it replaces.
+//----------------------------------------------------------------------
+
+int
+Machine::TLBSlotFor(int vpn)
+{
+    int set = (unsigned) vpn % tlbSets;
+
+    for (int i = set * tlbWays; i < (set + 1) * tlbWays; i++)
+	if (!tlb[i].valid)
+	    return i;
+    stats->numTLBEvictions++;
+    return tlbPolicy->Victim(set);
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBLoaded
+// 	Note that the kernel has loaded a new translation into TLB entry 
+//	"entry".
+//----------------------------------------------------------------------
+
+void
+Machine::TLBLoaded(int entry)
+{
+    ASSERT((entry >= 0) && (entry < tlbSize));
+    tlbPolicy->Loaded(entry);
+    FlushTranslationCache();
 }
 
 //----------------------------------------------------------------------
@@ -105,6 +285,7 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
+    interrupt->FlushTicks();		// bring the clock up to date
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
     interrupt->setStatus(UserMode);
@@ -24,6 +24,7 @@
 #include "copyright.h"
 #include "utility.h"
 #include "translate.h"
+#include "tlb.h"
 #include "disk.h"
 
 // Definitions related to the size, and format of user memory
@@ -35,6 +36,11 @@
 #define NumPhysPages    32
 #define MemorySize 	(NumPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
+					// (unless told otherwise, with -tlb)
+#define MinTLBSize	4
+#define MaxTLBSize	512
+#define TransCacheSize	64		// # of translations the simulator
+					// remembers, for reads and for writes
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -101,8 +107,10 @@ class Instruction {
 // If we were to implement more of the UNIX system calls, we ought to be
 // able to run Nachos on top of Nachos!
 //
-// The procedures in this class are defined in machine.cc, mipssim.cc, and
-// translate.cc.
+// The procedures in this class are defined in machine.cc, mipssim.cc, 
+// mipsblock.cc, and translate.cc.
+
+class BlockCache;
 
 class Machine {
   public:
@@ -123,6 +131,12 @@ class Machine {
 
     void OneInstruction(Instruction *instr); 	
     				// Run one instruction of a user program.
+    void RunBlocks();		// Run a user program a basic block at a
+				// time, out of the block cache
+    bool FetchDecoded(int addr, Instruction **instr);
+				// Fetch the instruction at "addr" out of
+				// the decode cache, decoding it on a miss.
+				// Return FALSE on an exception.
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -146,6 +160,32 @@ class Machine {
     void Debugger();		// invoke the user program debugger
     void DumpState();		// print the user CPU and memory state 
 
+    void EnableDecodeCache();	// Keep the decoded form of each 
+				// instruction fetched, indexed by 
+				// physical address
+    void EnableBlockCache();	// Run user programs a basic block at a
+				// time, keeping each block once decoded
+    void InvalidateDecodePage(int physPage);
+				// Forget the decoded instructions (and
+				// basic blocks) in a physical page; the 
+				// kernel must call this (or FlushDecodeCache)
+				// whenever it writes mainMemory directly, 
+				// eg, to load a page
+    void FlushDecodeCache();	// Forget all decoded instructions
+
+    void FlushTranslationCache();
+				// Forget the translations remembered by 
+				// the simulator; the kernel must call this
+				// whenever it changes the TLB or page table
+
+    void ConfigureTLB(int size, int ways, TLBReplacement policy);
+				// Replace the TLB with one of "size" entries,
+				// in sets of "ways", using "policy" to pick
+				// entries to replace
+    int TLBSlotFor(int vpn);	// Return the TLB entry the kernel should
+				// load the translation for "vpn" into
+    void TLBLoaded(int entry);	// The kernel has loaded a TLB entry
+
 
 // Data structures -- all of these are accessible to Nachos kernel code.
 // "public" for convenience.
@@ -178,6 +218,8 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int tlbSize;			// # of entries in the TLB; also 
+					// "read-only"
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
@@ -187,6 +229,28 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+
+    Instruction *decodeCache;	// decoded form of each word of mainMemory;
+				// NULL if the decode cache is disabled
+    bool *decodeValid;		// is the decodeCache entry for a word current?
+    bool *pageDecoded;		// does a physical page have any current 
+				// entries in the decode cache?
+    BlockCache *blockCache;	// decoded basic blocks, by physical address;
+				// NULL if we run one instruction at a time
+
+    int tlbWays;		// # of TLB entries in each set
+    int tlbSets;		// # of sets in the TLB
+    TLBPolicy *tlbPolicy;	// picks TLB entries to replace
+
+    bool transCacheOn;		// FALSE if we always take the slow path
+				// through Translate, eg, to trace it
+    TranslationEntry *readCache[TransCacheSize];
+    TranslationEntry *writeCache[TransCacheSize];
+				// the TLB or page table entry last used
+				// to read or write each virtual page,
+				// direct-mapped by virtual page #
+    TranslationEntry *cachedPageTable;	// the page table these came from
+    unsigned int cachedPageTableSize;
 };
 
 extern void ExceptionHandler(ExceptionType which);
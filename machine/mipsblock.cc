@@ -0,0 +1,931 @@
+// mipsblock.cc
+//	Routines to run user programs a basic block at a time.  See
+//	mipsblock.h for an overview.
+//
+//	Each kind of instruction is simulated by its own small routine;
+//	these must do exactly what the corresponding case of the switch
+//	statement in Machine::OneInstruction does, so that a program
+//	behaves (and takes) the same time whichever way it is run.
+//	In particular, the effect of a delayed load, and the program
+//	counter update, are only applied once we know the instruction
+//	did not cause an exception.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "machine.h"
+#include "mipssim.h"
+#include "mipsblock.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Instruction handlers
+//	One routine per instruction type.  Each returns FALSE if
+//	the instruction raised an exception.
+//
+//	"m" -- the machine to run the instruction on
+//	"instr" -- the decoded instruction
+//	"st" -- where to record a delayed load or a change in control flow
+//----------------------------------------------------------------------
+
+static bool
+DoAdd(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    int sum = r[instr->rs] + r[instr->rt];
+
+    if (!((r[instr->rs] ^ r[instr->rt]) & SIGN_BIT) &&
+	((r[instr->rs] ^ sum) & SIGN_BIT)) {
+	m->RaiseException(OverflowException, 0);
+	return FALSE;
+    }
+    r[instr->rd] = sum;
+    return TRUE;
+}
+
+static bool
+DoAddi(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    int sum = r[instr->rs] + instr->extra;
+
+    if (!((r[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+	((instr->extra ^ sum) & SIGN_BIT)) {
+	m->RaiseException(OverflowException, 0);
+	return FALSE;
+    }
+    r[instr->rt] = sum;
+    return TRUE;
+}
+
+static bool
+DoAddiu(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rt] = m->registers[instr->rs] + instr->extra;
+    return TRUE;
+}
+
+static bool
+DoAddu(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rs] + r[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoAnd(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rs] & r[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoAndi(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rt] = m->registers[instr->rs] & (instr->extra & 0xffff);
+    return TRUE;
+}
+
+static bool
+DoBeq(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (r[instr->rs] == r[instr->rt])
+	st->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBgez(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (!(r[instr->rs] & SIGN_BIT))
+	st->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBgezal(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[R31] = m->registers[NextPCReg] + 4;
+    return DoBgez(m, instr, st);
+}
+
+static bool
+DoBgtz(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (r[instr->rs] > 0)
+	st->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBlez(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (r[instr->rs] <= 0)
+	st->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBltz(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (r[instr->rs] & SIGN_BIT)
+	st->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBltzal(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[R31] = m->registers[NextPCReg] + 4;
+    return DoBltz(m, instr, st);
+}
+
+static bool
+DoBne(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (r[instr->rs] != r[instr->rt])
+	st->pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoDiv(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    if (r[instr->rt] == 0) {
+	r[LoReg] = 0;
+	r[HiReg] = 0;
+    } else {
+	r[LoReg] = r[instr->rs] / r[instr->rt];
+	r[HiReg] = r[instr->rs] % r[instr->rt];
+    }
+    return TRUE;
+}
+
+static bool
+DoDivu(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    unsigned int rs = (unsigned int) r[instr->rs];
+    unsigned int rt = (unsigned int) r[instr->rt];
+
+    if (rt == 0) {
+	r[LoReg] = 0;
+	r[HiReg] = 0;
+    } else {
+	r[LoReg] = (int) (rs / rt);
+	r[HiReg] = (int) (rs % rt);
+    }
+    return TRUE;
+}
+
+static bool
+DoJ(Machine *m, Instruction *instr, ExecState *st)
+{
+    st->pcAfter = (st->pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoJal(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[R31] = m->registers[NextPCReg] + 4;
+    return DoJ(m, instr, st);
+}
+
+static bool
+DoJr(Machine *m, Instruction *instr, ExecState *st)
+{
+    st->pcAfter = m->registers[instr->rs];
+    return TRUE;
+}
+
+static bool
+DoJalr(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rd] = m->registers[NextPCReg] + 4;
+    return DoJr(m, instr, st);
+}
+
+static bool
+DoLb(Machine *m, Instruction *instr, ExecState *st)
+{
+    int value;
+
+    if (!m->ReadMem(m->registers[instr->rs] + instr->extra, 1, &value))
+	return FALSE;
+    if ((value & 0x80) && (instr->opCode == OP_LB))
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    st->nextLoadReg = instr->rt;
+    st->nextLoadValue = value;
+    return TRUE;
+}
+
+static bool
+DoLh(Machine *m, Instruction *instr, ExecState *st)
+{
+    int addr = m->registers[instr->rs] + instr->extra;
+    int value;
+
+    if (addr & 0x1) {
+	m->RaiseException(AddressErrorException, addr);
+	return FALSE;
+    }
+    if (!m->ReadMem(addr, 2, &value))
+	return FALSE;
+    if ((value & 0x8000) && (instr->opCode == OP_LH))
+	value |= 0xffff0000;
+    else
+	value &= 0xffff;
+    st->nextLoadReg = instr->rt;
+    st->nextLoadValue = value;
+    return TRUE;
+}
+
+static bool
+DoLui(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rt] = instr->extra << 16;
+    return TRUE;
+}
+
+static bool
+DoLw(Machine *m, Instruction *instr, ExecState *st)
+{
+    int addr = m->registers[instr->rs] + instr->extra;
+    int value;
+
+    if (addr & 0x3) {
+	m->RaiseException(AddressErrorException, addr);
+	return FALSE;
+    }
+    if (!m->ReadMem(addr, 4, &value))
+	return FALSE;
+    st->nextLoadReg = instr->rt;
+    st->nextLoadValue = value;
+    return TRUE;
+}
+
+// The value a partial-word load merges into: if the target register
+// has a load to it in flight, merge with the value being loaded.
+static int
+LoadTarget(Machine *m, Instruction *instr)
+{
+    if (m->registers[LoadReg] == instr->rt)
+	return m->registers[LoadValueReg];
+    return m->registers[instr->rt];
+}
+
+static bool
+DoLwl(Machine *m, Instruction *instr, ExecState *st)
+{
+    int addr = m->registers[instr->rs] + instr->extra;
+    int value, result;
+
+    ASSERT((addr & 0x3) == 0);		// cf. Machine::OneInstruction
+    if (!m->ReadMem(addr, 4, &value))
+	return FALSE;
+    result = LoadTarget(m, instr);
+    switch (addr & 0x3) {
+      case 0:
+	result = value;
+	break;
+      case 1:
+	result = (result & 0xff) | (value << 8);
+	break;
+      case 2:
+	result = (result & 0xffff) | (value << 16);
+	break;
+      case 3:
+	result = (result & 0xffffff) | (value << 24);
+	break;
+    }
+    st->nextLoadReg = instr->rt;
+    st->nextLoadValue = result;
+    return TRUE;
+}
+
+static bool
+DoLwr(Machine *m, Instruction *instr, ExecState *st)
+{
+    int addr = m->registers[instr->rs] + instr->extra;
+    int value, result;
+
+    ASSERT((addr & 0x3) == 0);		// cf. Machine::OneInstruction
+    if (!m->ReadMem(addr, 4, &value))
+	return FALSE;
+    result = LoadTarget(m, instr);
+    switch (addr & 0x3) {
+      case 0:
+	result = (result & 0xffffff00) | ((value >> 24) & 0xff);
+	break;
+      case 1:
+	result = (result & 0xffff0000) | ((value >> 16) & 0xffff);
+	break;
+      case 2:
+	result = (result & 0xff000000) | ((value >> 8) & 0xffffff);
+	break;
+      case 3:
+	result = value;
+	break;
+    }
+    st->nextLoadReg = instr->rt;
+    st->nextLoadValue = result;
+    return TRUE;
+}
+
+static bool
+DoMfhi(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rd] = m->registers[HiReg];
+    return TRUE;
+}
+
+static bool
+DoMflo(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rd] = m->registers[LoReg];
+    return TRUE;
+}
+
+static bool
+DoMthi(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[HiReg] = m->registers[instr->rs];
+    return TRUE;
+}
+
+static bool
+DoMtlo(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[LoReg] = m->registers[instr->rs];
+    return TRUE;
+}
+
+static bool
+DoMult(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    Mult(r[instr->rs], r[instr->rt], (instr->opCode == OP_MULT),
+	 &r[HiReg], &r[LoReg]);
+    return TRUE;
+}
+
+static bool
+DoNor(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = ~(r[instr->rs] | r[instr->rt]);
+    return TRUE;
+}
+
+static bool
+DoOr(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rs] | r[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoOri(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rt] = m->registers[instr->rs] | (instr->extra & 0xffff);
+    return TRUE;
+}
+
+static bool
+DoSb(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    return m->WriteMem((unsigned) (r[instr->rs] + instr->extra), 1,
+			r[instr->rt]);
+}
+
+static bool
+DoSh(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    return m->WriteMem((unsigned) (r[instr->rs] + instr->extra), 2,
+			r[instr->rt]);
+}
+
+static bool
+DoSw(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    return m->WriteMem((unsigned) (r[instr->rs] + instr->extra), 4,
+			r[instr->rt]);
+}
+
+static bool
+DoSll(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rd] = m->registers[instr->rt] << instr->extra;
+    return TRUE;
+}
+
+static bool
+DoSllv(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rt] << (r[instr->rs] & 0x1f);
+    return TRUE;
+}
+
+static bool
+DoSlt(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = (r[instr->rs] < r[instr->rt]) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSlti(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rt] = (r[instr->rs] < instr->extra) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSltiu(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    unsigned int rs = r[instr->rs];
+    unsigned int imm = instr->extra;
+
+    r[instr->rt] = (rs < imm) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSltu(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    unsigned int rs = r[instr->rs];
+    unsigned int rt = r[instr->rt];
+
+    r[instr->rd] = (rs < rt) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSra(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rd] = m->registers[instr->rt] >> instr->extra;
+    return TRUE;
+}
+
+static bool
+DoSrav(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rt] >> (r[instr->rs] & 0x1f);
+    return TRUE;
+}
+
+// NOTE: like Machine::OneInstruction, SRL and SRLV shift a signed value.
+static bool
+DoSrl(Machine *m, Instruction *instr, ExecState *st)
+{
+    int tmp = m->registers[instr->rt];
+
+    tmp >>= instr->extra;
+    m->registers[instr->rd] = tmp;
+    return TRUE;
+}
+
+static bool
+DoSrlv(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    int tmp = r[instr->rt];
+
+    tmp >>= (r[instr->rs] & 0x1f);
+    r[instr->rd] = tmp;
+    return TRUE;
+}
+
+static bool
+DoSub(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    int diff = r[instr->rs] - r[instr->rt];
+
+    if (((r[instr->rs] ^ r[instr->rt]) & SIGN_BIT) &&
+	((r[instr->rs] ^ diff) & SIGN_BIT)) {
+	m->RaiseException(OverflowException, 0);
+	return FALSE;
+    }
+    r[instr->rd] = diff;
+    return TRUE;
+}
+
+static bool
+DoSubu(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rs] - r[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoSwl(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    int addr = r[instr->rs] + instr->extra;
+    int value;
+
+    ASSERT((addr & 0x3) == 0);		// cf. Machine::OneInstruction
+    if (!m->ReadMem((addr & ~0x3), 4, &value))
+	return FALSE;
+    switch (addr & 0x3) {
+      case 0:
+	value = r[instr->rt];
+	break;
+      case 1:
+	value = (value & 0xff000000) | ((r[instr->rt] >> 8) & 0xffffff);
+	break;
+      case 2:
+	value = (value & 0xffff0000) | ((r[instr->rt] >> 16) & 0xffff);
+	break;
+      case 3:
+	value = (value & 0xffffff00) | ((r[instr->rt] >> 24) & 0xff);
+	break;
+    }
+    return m->WriteMem((addr & ~0x3), 4, value);
+}
+
+static bool
+DoSwr(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+    int addr = r[instr->rs] + instr->extra;
+    int value;
+
+    ASSERT((addr & 0x3) == 0);		// cf. Machine::OneInstruction
+    if (!m->ReadMem((addr & ~0x3), 4, &value))
+	return FALSE;
+    switch (addr & 0x3) {
+      case 0:
+	value = (value & 0xffffff) | (r[instr->rt] << 24);
+	break;
+      case 1:
+	value = (value & 0xffff) | (r[instr->rt] << 16);
+	break;
+      case 2:
+	value = (value & 0xff) | (r[instr->rt] << 8);
+	break;
+      case 3:
+	value = r[instr->rt];
+	break;
+    }
+    return m->WriteMem((addr & ~0x3), 4, value);
+}
+
+static bool
+DoSyscall(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->RaiseException(SyscallException, 0);
+    return FALSE;
+}
+
+static bool
+DoXor(Machine *m, Instruction *instr, ExecState *st)
+{
+    int *r = m->registers;
+
+    r[instr->rd] = r[instr->rs] ^ r[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoXori(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->registers[instr->rt] = m->registers[instr->rs] ^ (instr->extra & 0xffff);
+    return TRUE;
+}
+
+static bool
+DoIllegal(Machine *m, Instruction *instr, ExecState *st)
+{
+    m->RaiseException(IllegalInstrException, 0);
+    return FALSE;
+}
+
+static bool
+DoBogus(Machine *m, Instruction *instr, ExecState *st)
+{
+    ASSERT(FALSE);		// Decode never produces this opcode
+    return FALSE;
+}
+
+// Handler for each opCode, filled in by InitHandlers.
+static InstrHandler handlerTable[MaxOpcode + 1];
+
+//----------------------------------------------------------------------
+// InitHandlers
+// 	Fill in the table mapping each opCode to the routine that
+//	simulates it.
+//----------------------------------------------------------------------
+
+static void
+InitHandlers()
+{
+    for (int i = 0; i <= MaxOpcode; i++)
+	handlerTable[i] = DoBogus;
+
+    handlerTable[OP_ADD] = DoAdd;
+    handlerTable[OP_ADDI] = DoAddi;
+    handlerTable[OP_ADDIU] = DoAddiu;
+    handlerTable[OP_ADDU] = DoAddu;
+    handlerTable[OP_AND] = DoAnd;
+    handlerTable[OP_ANDI] = DoAndi;
+    handlerTable[OP_BEQ] = DoBeq;
+    handlerTable[OP_BGEZ] = DoBgez;
+    handlerTable[OP_BGEZAL] = DoBgezal;
+    handlerTable[OP_BGTZ] = DoBgtz;
+    handlerTable[OP_BLEZ] = DoBlez;
+    handlerTable[OP_BLTZ] = DoBltz;
+    handlerTable[OP_BLTZAL] = DoBltzal;
+    handlerTable[OP_BNE] = DoBne;
+    handlerTable[OP_DIV] = DoDiv;
+    handlerTable[OP_DIVU] = DoDivu;
+    handlerTable[OP_J] = DoJ;
+    handlerTable[OP_JAL] = DoJal;
+    handlerTable[OP_JALR] = DoJalr;
+    handlerTable[OP_JR] = DoJr;
+    handlerTable[OP_LB] = DoLb;
+    handlerTable[OP_LBU] = DoLb;
+    handlerTable[OP_LH] = DoLh;
+    handlerTable[OP_LHU] = DoLh;
+    handlerTable[OP_LUI] = DoLui;
+    handlerTable[OP_LW] = DoLw;
+    handlerTable[OP_LWL] = DoLwl;
+    handlerTable[OP_LWR] = DoLwr;
+    handlerTable[OP_MFHI] = DoMfhi;
+    handlerTable[OP_MFLO] = DoMflo;
+    handlerTable[OP_MTHI] = DoMthi;
+    handlerTable[OP_MTLO] = DoMtlo;
+    handlerTable[OP_MULT] = DoMult;
+    handlerTable[OP_MULTU] = DoMult;
+    handlerTable[OP_NOR] = DoNor;
+    handlerTable[OP_OR] = DoOr;
+    handlerTable[OP_ORI] = DoOri;
+    handlerTable[OP_SB] = DoSb;
+    handlerTable[OP_SH] = DoSh;
+    handlerTable[OP_SLL] = DoSll;
+    handlerTable[OP_SLLV] = DoSllv;
+    handlerTable[OP_SLT] = DoSlt;
+    handlerTable[OP_SLTI] = DoSlti;
+    handlerTable[OP_SLTIU] = DoSltiu;
+    handlerTable[OP_SLTU] = DoSltu;
+    handlerTable[OP_SRA] = DoSra;
+    handlerTable[OP_SRAV] = DoSrav;
+    handlerTable[OP_SRL] = DoSrl;
+    handlerTable[OP_SRLV] = DoSrlv;
+    handlerTable[OP_SUB] = DoSub;
+    handlerTable[OP_SUBU] = DoSubu;
+    handlerTable[OP_SW] = DoSw;
+    handlerTable[OP_SWL] = DoSwl;
+    handlerTable[OP_SWR] = DoSwr;
+    handlerTable[OP_SYSCALL] = DoSyscall;
+    handlerTable[OP_XOR] = DoXor;
+    handlerTable[OP_XORI] = DoXori;
+    handlerTable[OP_RES] = DoIllegal;
+    handlerTable[OP_UNIMP] = DoIllegal;
+}
+
+//----------------------------------------------------------------------
+// EndsBlock
+// 	Return TRUE if an instruction can change the flow of control,
+//	so that it has to be the last one in its basic block.
+//----------------------------------------------------------------------
+
+static bool
+EndsBlock(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ:
+      case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL: case OP_BNE:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+      case OP_SYSCALL: case OP_RES: case OP_UNIMP:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// BlockCache::BlockCache
+// 	Initialize an empty cache of basic blocks, one slot for every
+//	word of physical memory.
+//----------------------------------------------------------------------
+
+BlockCache::BlockCache()
+{
+    int i;
+
+    InitHandlers();
+    blocks = new BasicBlock *[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	blocks[i] = NULL;
+    blocksInPage = new int[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	blocksInPage[i] = 0;
+    freeBlocks = NULL;
+    epoch = 0;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::~BlockCache
+// 	De-allocate all of the decoded blocks.
+//----------------------------------------------------------------------
+
+BlockCache::~BlockCache()
+{
+    BasicBlock *block;
+
+    for (int i = 0; i < NumPhysPages; i++)
+	InvalidatePage(i);
+    while (freeBlocks != NULL) {
+	block = freeBlocks;
+	freeBlocks = block->next;
+	delete block;
+    }
+    delete [] blocks;
+    delete [] blocksInPage;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Find
+// 	Return the basic block starting at physical address "physAddr".
+//	If we haven't seen it before, decode it: keep going until an
+//	instruction that changes the flow of control, or the end of
+//	the page.
+//
+//	"physAddr" -- the physical address of the first instruction
+//	"memory" -- the simulated physical memory
+//----------------------------------------------------------------------
+
+BasicBlock *
+BlockCache::Find(int physAddr, char *memory)
+{
+    BasicBlock *block = blocks[physAddr / 4];
+    Instruction *instr;
+    int addr, pageEnd;
+
+    if (block != NULL)
+	return block;
+
+    if (freeBlocks != NULL) {
+	block = freeBlocks;
+	freeBlocks = block->next;
+    } else
+	block = new BasicBlock;
+
+    block->physAddr = physAddr;
+    block->length = 0;
+    pageEnd = (physAddr / PageSize + 1) * PageSize;
+    addr = physAddr;
+    do {
+	instr = &block->code[block->length];
+	instr->value = WordToHost(*(unsigned int *) &memory[addr]);
+	instr->Decode();
+	ASSERT(instr->opCode <= MaxOpcode);
+	block->handler[block->length] = handlerTable[(int) instr->opCode];
+	block->length++;
+	addr += 4;
+    } while ((addr < pageEnd) && !EndsBlock(instr->opCode));
+
+    DEBUG('m', "Decoded block at 0x%x, %d instructions\n", physAddr,
+		block->length);
+    blocks[physAddr / 4] = block;
+    blocksInPage[physAddr / PageSize]++;
+    stats->numBlocksBuilt++;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::InvalidatePage
+// 	The contents of physical page "physPage" have changed, so throw
+//	away any blocks decoded from it.  Blocks never span pages, so no
+//	other blocks are affected.
+//----------------------------------------------------------------------
+
+void
+BlockCache::InvalidatePage(int physPage)
+{
+    BasicBlock **slot;
+
+    if (blocksInPage[physPage] == 0)
+	return;
+    slot = &blocks[physPage * (PageSize / 4)];
+    for (int i = 0; i < PageSize / 4; i++)
+	if (slot[i] != NULL) {
+	    slot[i]->next = freeBlocks;
+	    freeBlocks = slot[i];
+	    slot[i] = NULL;
+	}
+    blocksInPage[physPage] = 0;
+    epoch++;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlocks
+// 	Simulate the execution of a user program, a basic block at a
+//	time.  Called by Machine::Run; never returns.
+//
+//	Every instruction fetch is still translated, so that page faults,
+//	TLB misses, and the use bits come out exactly as they would
+//	from OneInstruction.  But if the instruction is the next one in
+//	the block we are already running, we don't need to look anything
+//	up; we just call its handler.  The clock still advances (and
+//	interrupts can still happen) after every instruction, exactly
+//	as in Machine::Run.
+//
+//	Since a context switch can happen during any interrupt or
+//	exception, everything we know about the block we were in is kept
+//	in local variables: each thread running user code has its own.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlocks()
+{
+    BasicBlock *block = NULL;	// the block we are running, if any
+    int next = 0;		// index in "block" of the next instruction
+    int epoch = 0;		// blockCache->Epoch() when we found "block"
+    ExecState state;
+    ExceptionType exception;
+    int pc, physAddr;
+
+    for (;;) {
+	pc = registers[PCReg];
+	exception = Translate(pc, &physAddr, 4, FALSE);
+	if (exception != NoException) {
+	    RaiseException(exception, pc);
+	    block = NULL;
+	} else {
+	    if ((block == NULL) || (epoch != blockCache->Epoch())
+			|| (next >= block->length)
+			|| (physAddr != block->physAddr + 4 * next)) {
+		block = blockCache->Find(physAddr, mainMemory);
+		epoch = blockCache->Epoch();
+		next = 0;
+		stats->numBlocksEntered++;
+	    }
+	    state.nextLoadReg = 0;
+	    state.nextLoadValue = 0;
+	    state.pcAfter = registers[NextPCReg] + 4;
+	    if ((*block->handler[next])(this, &block->code[next], &state)) {
+		DelayedLoad(state.nextLoadReg, state.nextLoadValue);
+		registers[PrevPCReg] = registers[PCReg];
+		registers[PCReg] = registers[NextPCReg];
+		registers[NextPCReg] = state.pcAfter;
+		next++;
+	    }
+	}
+	if (!singleStep)
+	    interrupt->OneUserTick();
+	else {
+	    interrupt->OneTick();
+	    if (runUntilTime <= stats->totalTicks)
+		Debugger();
+	}
+    }
+}
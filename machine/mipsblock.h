@@ -0,0 +1,87 @@
+// mipsblock.h
+//	Data structures for running user programs a basic block at a
+//	time, rather than one instruction at a time.
+//
+//	A basic block is a straight-line run of instructions, ending
+//	with the first branch, jump or system call (or the end of the
+//	physical page).  The first time we reach a block we decode all
+//	of its instructions, and look up the routine that simulates each
+//	one; after that, running the block is just a matter of calling
+//	through the table of handlers, with no decoding and no big
+//	switch statement.
+//
+//	Blocks are found by physical address, so they stay correct when
+//	the page table or TLB changes.  They are thrown away whenever the
+//	page they were decoded from is written.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef MIPSBLOCK_H
+#define MIPSBLOCK_H
+
+#include "copyright.h"
+#include "machine.h"
+
+// The results of simulating one instruction, that have to be applied
+// once we know the instruction did not cause an exception.
+
+class ExecState {
+  public:
+    int nextLoadReg;		// the target of a delayed load, if any
+    int nextLoadValue;		// the value to be loaded by it
+    int pcAfter;		// where to go after the next instruction
+};
+
+// Routine to simulate one kind of instruction.  Returns FALSE if the
+// instruction raised an exception, in which case it has no other effect.
+
+typedef bool (*InstrHandler)(Machine *machine, Instruction *instr,
+				ExecState *state);
+
+#define MaxBlockSize	(PageSize / 4)	// a block never spans two pages
+
+// The following class defines a decoded basic block.
+
+class BasicBlock {
+  public:
+    int physAddr;			// where the block starts in mainMemory
+    int length;				// # of instructions in the block
+    Instruction code[MaxBlockSize];	// the decoded instructions
+    InstrHandler handler[MaxBlockSize];	// routine to run each one
+    BasicBlock *next;			// next block on the free list
+};
+
+// The following class defines the set of basic blocks that have been
+// decoded so far, indexed by the physical address they start at.
+
+class BlockCache {
+  public:
+    BlockCache();			// Initialize an empty cache
+    ~BlockCache();			// De-allocate every block
+
+    BasicBlock *Find(int physAddr, char *memory);
+					// Return the block starting at
+					// "physAddr", decoding it out of
+					// "memory" if we haven't yet
+    void InvalidatePage(int physPage);	// Throw away the blocks decoded
+					// from a physical page
+
+    int Epoch() { return epoch; }	// Changes whenever blocks are thrown
+					// away, so that anyone holding a
+					// pointer to a block knows to look
+					// it up again
+
+  private:
+    BasicBlock **blocks;		// block starting at each word of
+					// memory, NULL if none
+    int *blocksInPage;			// # of blocks starting in each page
+    BasicBlock *freeBlocks;		// blocks to recycle.  We never
+					// delete a block while the machine is
+					// running, in case a handler is still
+					// using it
+    int epoch;
+};
+
+#endif // MIPSBLOCK_H
@@ -16,8 +16,6 @@
 #include "mipssim.h"
 #include "system.h"
 
-static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -36,11 +34,19 @@ Machine::Run()
         printf("Starting thread \"%s\" at time %d\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
+    if (blockCache != NULL && !DebugIsEnabled('m')) {
+	delete instr;
+	RunBlocks();		// never returns
+    }
     for (;;) {
         OneInstruction(instr);
-	interrupt->OneTick();
-	if (singleStep && (runUntilTime <= stats->totalTicks))
-	  Debugger();
+	if (!singleStep)
+	    interrupt->OneUserTick();
+	else {
+	    interrupt->OneTick();
+	    if (runUntilTime <= stats->totalTicks)
+		Debugger();
+	}
     }
 }
 
@@ -99,10 +105,15 @@ Machine::OneInstruction(Instruction *instr)
 				// in the future
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    if (decodeCache != NULL) {
+	if (!FetchDecoded(registers[PCReg], &instr))
+	    return;		// exception occurred
+    } else {
+	if (!machine->ReadMem(registers[PCReg], 4, &raw))
+	    return;		// exception occurred
+	instr->value = raw;
+	instr->Decode();
+    }
 
     if (DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[instr->opCode];
@@ -373,7 +384,7 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_OR:
-	registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
+	registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
 	break;
 	
       case OP_ORI:
@@ -564,6 +575,46 @@ Machine::OneInstruction(Instruction *instr)
     registers[NextPCReg] = pcAfter;
 }
 
+//----------------------------------------------------------------------
+// Machine::FetchDecoded
+// 	Fetch the instruction at virtual address "addr" from the decode
+//	cache.  The address is still translated, so that page faults,
+//	TLB misses and the use bits behave exactly as for an ordinary
+//	fetch; but on a hit we skip both reading memory and Decode().
+//
+//	Returns FALSE if the translation failed (the exception has
+//	already been raised).
+//
+//	"addr" -- the virtual address of the instruction
+//	"instr" -- set to point to the decoded instruction
+//----------------------------------------------------------------------
+
+bool
+Machine::FetchDecoded(int addr, Instruction **instr)
+{
+    ExceptionType exception;
+    int physAddr, index;
+
+    exception = Translate(addr, &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, addr);
+	return FALSE;
+    }
+    index = physAddr / 4;
+    if (decodeValid[index]) {
+	stats->numDecodeHits++;
+    } else {
+	decodeCache[index].value = 
+		WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	decodeCache[index].Decode();
+	decodeValid[index] = TRUE;
+	pageDecoded[physAddr / PageSize] = TRUE;
+	stats->numDecodeMisses++;
+    }
+    *instr = &decodeCache[index];
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Machine::DelayedLoad
 // 	Simulate effects of a delayed load.
@@ -632,7 +683,7 @@ Instruction::Decode()
 // 	double-length result of the multiplication.
 //----------------------------------------------------------------------
 
-static void
+void
 Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
 {
     if ((a == 0) || (b == 0)) {
@@ -10,6 +10,7 @@
 #include "copyright.h"
 #include "utility.h"
 #include "stats.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // Statistics::Statistics
@@ -20,8 +21,65 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = numCacheWritebacks = 0;
+    numReadAheads = numFlushes = numFlushRuns = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numDecodeHits = numDecodeMisses = 0;
+    numBlocksBuilt = numBlocksEntered = 0;
+    numTLBHits = numTLBMisses = numTLBEvictions = 0;
+    numListAllocs = numListReuses = numListLinks = 0;
+    numContextSwitches = 0;
+    numStackAllocs = numStackReuses = 0;
+    numLockAcquires = numLockWaits = 0;
+    numPageEvictions = numPageWritebacks = numZeroFillFaults = 0;
+    numCOWFaults = numCOWCopies = numTextShares = 0;
+    firstThread = lastThread = NULL;
+    printThreads = FALSE;
+    firstCpu = lastCpu = NULL;
+}
+
+//----------------------------------------------------------------------
+// Statistics::NewThread
+// 	Return a new record for the statistics of thread "threadName".
+//	If we are going to print it at the end, add it to our list, and
+//	keep it after the thread is gone; otherwise the thread owns it,
+//	so that a program that creates many threads doesn't fill up
+//	memory with records nobody will look at.
+//----------------------------------------------------------------------
+
+ThreadStatistics *
+Statistics::NewThread(char *threadName)
+{
+    ThreadStatistics *t = new ThreadStatistics(threadName);
+
+    if (!printThreads)
+	return t;
+    if (lastThread == NULL)
+	firstThread = t;
+    else
+	lastThread->next = t;
+    lastThread = t;
+    return t;
+}
+
+//----------------------------------------------------------------------
+// Statistics::NewCpu
+// 	Return a new record for the statistics of CPU "cpuId", adding it
+//	to the end of our list.
+//----------------------------------------------------------------------
+
+CpuStatistics *
+Statistics::NewCpu(int cpuId)
+{
+    CpuStatistics *c = new CpuStatistics(cpuId);
+
+    if (lastCpu == NULL)
+	firstCpu = c;
+    else
+	lastCpu->next = c;
+    lastCpu = c;
+    return c;
 }
 
 //----------------------------------------------------------------------
@@ -36,9 +94,144 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numCacheHits + numCacheMisses > 0)
+	printf("Buffer cache: hits %d, misses %d, write-backs %d, "
+	    "read-aheads %d\n", numCacheHits, numCacheMisses, 
+	    numCacheWritebacks, numReadAheads);
+    if (numFlushRuns > 0)
+	printf("Write-behind: flushes %d, runs of sectors %d\n", numFlushes,
+	    numFlushRuns);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    if (numZeroFillFaults > 0)
+	printf("Zero-fill: faults %d\n", numZeroFillFaults);
+    if (numPageEvictions > 0)
+	printf("Page replacement: evictions %d, dirty write-backs %d\n", 
+	    numPageEvictions, numPageWritebacks);
+    if (numTextShares > 0)
+	printf("Shared text: pages %d\n", numTextShares);
+    if (numCOWFaults > 0)
+	printf("Copy-on-write: faults %d, copies %d\n", numCOWFaults, 
+	    numCOWCopies);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    if (numDecodeHits + numDecodeMisses > 0)
+	printf("Decode cache: hits %d, misses %d\n", numDecodeHits, 
+	    numDecodeMisses);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %d, misses %d, evictions %d\n", numTLBHits, 
+	    numTLBMisses, numTLBEvictions);
+    if (numListAllocs + numListReuses + numListLinks > 0)
+	printf("List elements: allocated %d, reused %d, embedded %d\n", 
+	    numListAllocs, numListReuses, numListLinks);
+    if (numContextSwitches > 0)
+	printf("Context switches: %d\n", numContextSwitches);
+    if (numStackAllocs > 0)
+	printf("Thread stacks: allocated %d, reused %d\n", numStackAllocs,
+	    numStackReuses);
+    if (numLockAcquires > 0)
+	printf("Locks: acquires %d, waits %d\n", numLockAcquires, 
+	    numLockWaits);
+    if (numBlocksBuilt > 0)
+	printf("Basic blocks: built %d, entered %d\n", numBlocksBuilt, 
+	    numBlocksEntered);
+    if ((firstCpu != NULL) && (firstCpu != lastCpu))
+	for (CpuStatistics *c = firstCpu; c != NULL; c = c->next)
+	    c->Print(totalTicks);
+    if (printThreads)
+	for (ThreadStatistics *t = firstThread; t != NULL; t = t->next)
+	    t->Print();
+}
+
+// What each activity is called, when it is printed
+static char *activityNames[] = { "not started", "running", "ready", 
+				 "semaphore", "lock", "condition", "disk",
+				 "console", "network", "alarm", "other", 
+				 "finished" };
+
+//----------------------------------------------------------------------
+// ThreadStatistics::ThreadStatistics
+// 	Initialize the statistics for a thread that has just been 
+//	created, but not started.
+//----------------------------------------------------------------------
+
+ThreadStatistics::ThreadStatistics(char *threadName)
+{
+    name = threadName;
+    for (int i = 0; i < NumActivities; i++)
+	ticks[i] = 0;
+    maxReadyWait = numDispatches = numYields = 0;
+    lastDispatch = -1;
+    next = NULL;
+    activity = NotStarted;
+    since = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::Charge
+// 	Record that the thread has started doing "nextActivity"; charge 
+//	the time since its last change of activity to what it was doing.
+//----------------------------------------------------------------------
+
+void
+ThreadStatistics::Charge(ThreadActivity nextActivity)
+{
+    int elapsed = stats->totalTicks - since;
+
+    ticks[activity] += elapsed;
+    if ((activity == Ready) && (elapsed > maxReadyWait))
+	maxReadyWait = elapsed;
+    activity = nextActivity;
+    since = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::Print
+// 	Print the statistics for a thread: how long it has spent running,
+//	waiting to run, and blocked on each kind of thing.  Time since the
+//	thread's last change of activity counts as well.
+//----------------------------------------------------------------------
+
+void
+ThreadStatistics::Print()
+{
+    Charge(activity);
+    printf("Thread \"%s\": %s; running %d, ready %d (longest %d)",
+	name, activityNames[activity], ticks[Running], ticks[Ready],
+	maxReadyWait);
+    for (int i = BlockedOnSemaphore; i <= BlockedOther; i++)
+	if (ticks[i] > 0)
+	    printf(", %s %d", activityNames[i], ticks[i]);
+    printf("; dispatched %d, yielded %d", numDispatches, numYields);
+    if (lastDispatch >= 0)
+	printf(", last at %d", lastDispatch);
+    printf("\n");
+}
+
+//----------------------------------------------------------------------
+// CpuStatistics::CpuStatistics
+// 	Initialize the statistics for CPU "cpuId".
+//----------------------------------------------------------------------
+
+CpuStatistics::CpuStatistics(int cpuId)
+{
+    id = cpuId;
+    busyTicks = 0;
+    numDispatches = numSteals = numIPIs = numSpins = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// CpuStatistics::Print
+// 	Print the statistics for a CPU: how long it was busy, and how
+//	long idle, out of "totalTicks".
+//----------------------------------------------------------------------
+
+void
+CpuStatistics::Print(int totalTicks)
+{
+    printf("CPU %d: busy %d, idle %d; dispatched %d, stole %d, IPIs %d, "
+	"spins %d\n", id, busyTicks, totalTicks - busyTicks, numDispatches,
+	numSteals, numIPIs, numSpins);
 }
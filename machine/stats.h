@@ -13,6 +13,61 @@
 
 #include "copyright.h"
 
+// What a thread is doing with its time.  A blocked thread's time is 
+// split up by what it is waiting for.
+
+enum ThreadActivity { NotStarted, Running, Ready, BlockedOnSemaphore,
+		      BlockedOnLock, BlockedOnCondition, BlockedOnDisk,
+		      BlockedOnConsole, BlockedOnNetwork, BlockedOnAlarm,
+		      BlockedOther,
+		      Finished, NumActivities };
+
+// The following class defines the statistics kept about each thread,
+// to find out which threads are starved of the CPU, or hogging it.
+// With -ts, the record outlives the thread, so that it can be printed
+// at the end; otherwise the thread deletes it when it is destroyed.
+
+class ThreadStatistics {
+  public:
+    ThreadStatistics(char *threadName);	// start accounting for a thread
+
+    void Charge(ThreadActivity next);	// the thread is now doing "next";
+					// charge the time since the last
+					// change to what it was doing
+
+    void Print();			// print the thread's statistics
+
+    char *name;			// the thread's name
+    int ticks[NumActivities];	// time spent on each activity
+    int maxReadyWait;		// longest wait on the ready list
+    int numDispatches;		// times the thread was given the CPU
+    int numYields;		// ... and gave it up while still ready
+    int lastDispatch;		// when it was last given the CPU
+    ThreadStatistics *next;	// the next thread created
+
+  private:
+    ThreadActivity activity;	// what the thread is doing
+    int since;			// ... since when
+};
+
+// The following class defines the statistics kept about each CPU,
+// when there is more than one.
+
+class CpuStatistics {
+  public:
+    CpuStatistics(int cpuId);		// start accounting for a CPU
+
+    void Print(int totalTicks);		// print the CPU's statistics
+
+    int id;			// which CPU
+    int busyTicks;		// time spent running threads
+    int numDispatches;		// threads it switched to
+    int numSteals;		// ... taken from another CPU's ready list
+    int numIPIs;		// interrupts from other CPUs, to wake it up
+    int numSpins;		// times it went round a spin lock
+    CpuStatistics *next;	// the next CPU
+};
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -30,14 +85,54 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numCacheHits;		// disk sectors found in the buffer cache
+    int numCacheMisses;		// ... and not found
+    int numCacheWritebacks;	// modified sectors written back from it
+    int numReadAheads;		// sectors read into it ahead of time
+    int numFlushes;		// times the flusher wrote sectors back
+    int numFlushRuns;		// runs of consecutive sectors written back
+				// by the flusher (or Sync)
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numZeroFillFaults;	// page faults on pages that start as zeroes
+    int numPageEvictions;	// pages evicted to make room for others
+    int numPageWritebacks;	// evicted pages that had to be written back
+    int numCOWFaults;		// writes to copy-on-write pages
+    int numCOWCopies;		// ... that had to copy the page
+    int numTextShares;		// page faults on text another process had
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numDecodeHits;		// instruction fetches found already decoded
+    int numDecodeMisses;	// instruction fetches that had to be decoded
+    int numBlocksBuilt;		// basic blocks decoded
+    int numBlocksEntered;	// times we started running a basic block
+    int numTLBHits;		// translations found in the TLB
+    int numTLBMisses;		// translations not found in the TLB
+    int numTLBEvictions;	// valid TLB entries replaced by the kernel
+    int numListAllocs;		// list elements allocated
+    int numListReuses;		// list elements reused instead
+    int numListLinks;		// items put on lists with their own element
+    int numContextSwitches;	// times the CPU switched threads
+    int numStackAllocs;		// thread stacks allocated
+    int numStackReuses;		// ... and reused, from finished threads
+    int numLockAcquires;	// locks acquired
+    int numLockWaits;		// ... that had to wait for another thread
+
+    ThreadStatistics *firstThread;  // statistics for each thread, in the
+    ThreadStatistics *lastThread;   // order they were created
+    bool printThreads;		// print them? (-ts)
+    CpuStatistics *firstCpu;	// statistics for each CPU
+    CpuStatistics *lastCpu;
 
     Statistics(); 		// initialize everything to zero
 
+    ThreadStatistics *NewThread(char *threadName);
+				// start keeping statistics for a thread;
+				// the record is ours to keep only if
+				// printThreads is set
+    CpuStatistics *NewCpu(int cpuId);
+				// ... and for a CPU
     void Print();		// print collected statistics
 };
 
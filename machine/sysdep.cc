@@ -33,6 +33,7 @@ extern "C" {
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/file.h>
+#include <sys/stat.h>
 #include <sys/un.h>
 #include <sys/mman.h>
 #ifdef HOST_i386
@@ -242,6 +243,21 @@ Tell(int fd)
 }
 
 
+//----------------------------------------------------------------------
+// FileIdentity
+// 	Return a number identifying an open file, the same for every
+//	open of the same file: its inode number.  Abort on error.
+//----------------------------------------------------------------------
+
+int
+FileIdentity(int fd)
+{
+    struct stat info;
+    int retVal = fstat(fd, &info);
+    ASSERT(retVal >= 0);
+    return (int) info.st_ino;
+}
+
 //----------------------------------------------------------------------
 // Close
 // 	Close a file.  Abort on error.
@@ -501,3 +517,62 @@ DeallocBoundedArray(char *ptr, int size)
     mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
     delete [] (ptr - pgSize);
 }
+
+//----------------------------------------------------------------------
+// AllocGuardedArray
+// 	Like AllocBoundedArray, but the pages on either side of the array
+//	really are inaccessible, so that a reference off either end causes
+//	a segmentation fault.  The array is mapped in whole pages of its
+//	own, so it costs a system call or three: best allocated once and
+//	kept.
+//
+//	"size" -- amount of useful space needed (in bytes); rounded up to
+//		a whole number of pages
+//----------------------------------------------------------------------
+
+char *
+AllocGuardedArray(int size)
+{
+    int pgSize = getpagesize();
+    int length = divRoundUp(size, pgSize) * pgSize;
+    char *ptr = (char *) mmap(NULL, length + 2 * pgSize, 
+				PROT_READ | PROT_WRITE | PROT_EXEC,
+				MAP_PRIVATE | MAP_ANON, -1, 0);
+
+    ASSERT(ptr != (char *) MAP_FAILED);
+    mprotect(ptr, pgSize, PROT_NONE);
+    mprotect(ptr + pgSize + length, pgSize, PROT_NONE);
+    return ptr + pgSize;
+}
+
+//----------------------------------------------------------------------
+// DeallocGuardedArray
+// 	Unmap an array allocated by AllocGuardedArray, guard pages and all.
+//
+//	"ptr" -- the array to be deallocated
+//	"size" -- amount of useful space in the array (in bytes)
+//----------------------------------------------------------------------
+
+void
+DeallocGuardedArray(char *ptr, int size)
+{
+    int pgSize = getpagesize();
+    int length = divRoundUp(size, pgSize) * pgSize;
+
+    munmap(ptr - pgSize, length + 2 * pgSize);
+}
+
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the host's wall-clock time, in seconds, for timing 
+//	benchmarks in real time rather than simulated ticks.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
@@ -26,6 +26,7 @@ extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
+extern int FileIdentity(int fd);
 extern void Close(int fd);
 extern bool Unlink(char *name);
 
@@ -55,6 +56,13 @@ extern int Random();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// ... with the pages on either side of it really unmapped
+extern char *AllocGuardedArray(int size);
+extern void DeallocGuardedArray(char *p, int size);
+
+// Wall-clock time on the host, in seconds
+extern double HostTime();
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
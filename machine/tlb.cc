@@ -0,0 +1,126 @@
+// tlb.cc
+//	Routines to choose which entry of the simulated TLB to replace.
+//	See tlb.h for an overview.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tlb.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// TLBPolicy::TLBPolicy
+// 	Initialize the replacement state for a TLB.
+//
+//	"policy" -- which replacement policy to use
+//	"numEntries" -- the total # of entries in the TLB
+//	"numWays" -- the # of entries in each set
+//----------------------------------------------------------------------
+
+TLBPolicy::TLBPolicy(TLBReplacement policy, int numEntries, int numWays)
+{
+    int i;
+
+    ASSERT((numWays > 0) && ((numEntries % numWays) == 0));
+    kind = policy;
+    ways = numWays;
+    now = 0;
+    stamp = new int[numEntries];
+    referenced = new bool[numEntries];
+    for (i = 0; i < numEntries; i++) {
+	stamp[i] = 0;
+	referenced[i] = FALSE;
+    }
+    hand = new int[numEntries / numWays];
+    for (i = 0; i < numEntries / numWays; i++)
+	hand[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// TLBPolicy::~TLBPolicy
+// 	De-allocate the replacement state.
+//----------------------------------------------------------------------
+
+TLBPolicy::~TLBPolicy()
+{
+    delete [] stamp;
+    delete [] referenced;
+    delete [] hand;
+}
+
+//----------------------------------------------------------------------
+// TLBPolicy::Loaded
+// 	Note that the kernel has just put a new translation in "entry".
+//	A newly loaded entry counts as recently used.
+//----------------------------------------------------------------------
+
+void
+TLBPolicy::Loaded(int entry)
+{
+    stamp[entry] = ++now;
+    referenced[entry] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// TLBPolicy::Victim
+// 	Return the entry in "set" that should be replaced next.  We
+//	assume every entry in the set is valid; otherwise, the caller
+//	should just use an invalid one.
+//----------------------------------------------------------------------
+
+int
+TLBPolicy::Victim(int set)
+{
+    int first = set * ways;
+    int victim, i;
+
+    switch (kind) {
+      case TLBRandom:
+	return first + (Random() % ways);
+
+      case TLBClock:
+	for (;;) {			// terminates by the second time around
+	    victim = first + hand[set];
+	    hand[set] = (hand[set] + 1) % ways;
+	    if (!referenced[victim])
+		return victim;
+	    referenced[victim] = FALSE;	// give it a second chance
+	}
+
+      case TLBFifo:			// oldest stamp: loaded longest ago
+      case TLBLru:			// oldest stamp: used longest ago
+	victim = first;
+	for (i = first + 1; i < first + ways; i++)
+	    if (stamp[i] < stamp[victim])
+		victim = i;
+	return victim;
+    }
+    ASSERT(FALSE);
+    return first;
+}
+
+//----------------------------------------------------------------------
+// TLBPolicyNamed
+// 	Return the replacement policy with the given name, as given
+//	on the command line.
+//----------------------------------------------------------------------
+
+TLBReplacement
+TLBPolicyNamed(char *name)
+{
+    if (!strcmp(name, "fifo"))
+	return TLBFifo;
+    else if (!strcmp(name, "random"))
+	return TLBRandom;
+    else if (!strcmp(name, "lru"))
+	return TLBLru;
+    else if (!strcmp(name, "clock"))
+	return TLBClock;
+    printf("Unknown TLB replacement policy \"%s\"\n", name);
+    ASSERT(FALSE);
+    return TLBFifo;
+}
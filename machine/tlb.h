@@ -0,0 +1,65 @@
+// tlb.h
+//	Data structures to choose which entry of the simulated TLB
+//	to replace, when the kernel loads a new translation into it.
+//
+//	The TLB is split into sets of "ways" entries each; a virtual
+//	page can only be held in one set (chosen by its page number),
+//	and the hardware searches only that set.  A fully associative
+//	TLB has a single set; a direct-mapped TLB has one way per set.
+//
+//	When every way of a set is in use, the replacement policy picks
+//	the victim.  To do that, it is told about every TLB hit (Touch),
+//	and every new entry (Loaded).  We support:
+//		FIFO -- replace the entry loaded longest ago
+//		random -- replace any entry
+//		LRU -- replace the entry used longest ago
+//		clock -- second chance, using a reference bit per entry
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBPOLICY_H
+#define TLBPOLICY_H
+
+#include "copyright.h"
+#include "utility.h"
+
+enum TLBReplacement { TLBFifo, TLBRandom, TLBLru, TLBClock };
+
+// The following class defines the state kept by the TLB hardware
+// to implement a replacement policy.  Entries are numbered as in
+// the TLB: the ways of set "s" are entries s*ways .. s*ways + ways - 1.
+
+class TLBPolicy {
+  public:
+    TLBPolicy(TLBReplacement policy, int numEntries, int numWays);
+					// Initialize the policy state
+    ~TLBPolicy();			// De-allocate it
+
+    void Touch(int entry) {		// The hardware used "entry"
+	if (kind == TLBLru)
+	    stamp[entry] = ++now;
+	else if (kind == TLBClock)
+	    referenced[entry] = TRUE;
+    }
+    void Loaded(int entry);		// The kernel loaded "entry"
+    int Victim(int set);		// Return the entry in "set" to replace
+
+  private:
+    TLBReplacement kind;		// which policy
+    int ways;				// # of entries per set
+    int *stamp;				// FIFO: when each entry was loaded
+					// LRU: when each entry was last used
+    int now;				// counter for "stamp"
+    bool *referenced;			// clock: used since the hand passed?
+    int *hand;				// clock: next way to look at, per set
+};
+
+extern TLBReplacement TLBPolicyNamed(char *name);
+					// Parse "fifo", "random", "lru" or
+					// "clock" (for -tlbpolicy)
+
+#endif // TLBPOLICY_H
@@ -23,6 +23,13 @@
 //	Note that the contents of the TLB are specific to an address space.
 //	If the address space changes, so does the contents of the TLB!
 //
+//	Looking up the TLB is slow to simulate (it is searched one entry
+//	at a time), so the simulator also keeps a small direct-mapped
+//	cache of the entries it has used recently.  This is invisible to 
+//	the kernel: each cached entry is checked again when it is used,
+//	exactly as the hardware would, and use and dirty bits are set
+//	in the TLB or page table as usual.
+//
 // DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -147,6 +154,9 @@ Machine::WriteMem(int addr, int size, int value)
 	machine->RaiseException(exception, addr);
 	return FALSE;
     }
+    if (decodeCache != NULL || blockCache != NULL)
+					// in case we're overwriting code
+	InvalidateDecodePage(physicalAddress / PageSize);
     switch (size) {
       case 1:
 	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -181,6 +191,11 @@ Machine::WriteMem(int addr, int size, int value)
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
 // 	"writing" -- if TRUE, check the "read-only" bit in the TLB
+//
+//	The fast path: if we have used a TLB or page table entry for this
+//	virtual page recently, and it still holds the same translation 
+//	(with the right permission), use it without searching.  Otherwise,
+//	look up the translation as usual, and remember the entry found.
 //----------------------------------------------------------------------
 
 ExceptionType
@@ -189,6 +204,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     int i;
     unsigned int vpn, offset;
     TranslationEntry *entry;
+    TranslationEntry **cached;
     unsigned int pageFrame;
 
     DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
@@ -198,6 +214,34 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	DEBUG('a', "alignment problem at %d, size %d!\n", virtAddr, size);
 	return AddressErrorException;
     }
+
+    vpn = (unsigned) virtAddr / PageSize;
+    if (transCacheOn) {
+	if ((pageTable != cachedPageTable) 
+			|| (pageTableSize != cachedPageTableSize))
+	    FlushTranslationCache();	// kernel switched page tables
+	cached = writing ? &writeCache[vpn % TransCacheSize] 
+			 : &readCache[vpn % TransCacheSize];
+	entry = *cached;
+	if ((entry != NULL) && entry->valid 
+		&& ((tlb == NULL) ? (entry == &pageTable[vpn]) 
+				  : (entry->virtualPage == (int) vpn))
+		&& !(writing && entry->readOnly)
+		&& (entry->physicalPage >= 0) 
+		&& (entry->physicalPage < NumPhysPages)) {
+	    entry->use = TRUE;
+	    if (writing)
+		entry->dirty = TRUE;
+	    if (tlb != NULL) {
+		stats->numTLBHits++;
+		tlbPolicy->Touch(entry - tlb);
+	    }
+	    *physAddr = entry->physicalPage * PageSize 
+				+ (unsigned) virtAddr % PageSize;
+	    return NoException;
+	}
+    } else
+	cached = NULL;
     
     // we must have either a TLB or a page table, but not both!
     ASSERT(tlb == NULL || pageTable == NULL);	
@@ -219,18 +263,23 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	    return PageFaultException;
 	}
 	entry = &pageTable[vpn];
-    } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
+    } else {			// => TLB => search the set for vpn
+	int set = vpn % tlbSets;
+
+        for (entry = NULL, i = set * tlbWays; i < (set + 1) * tlbWays; i++)
     	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
 	if (entry == NULL) {				// not found
     	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+	    stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	stats->numTLBHits++;
+	tlbPolicy->Touch(i);
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -251,5 +300,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
+    if (cached != NULL)
+	*cached = entry;		// remember it for next time
     return NoException;
 }
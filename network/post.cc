@@ -38,6 +38,7 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
     pktHdr = pktH;
     mailHdr = mailH;
     bcopy(msgData, data, mailHdr.length);
+    link.item = (void *) this;
 }
 
 //----------------------------------------------------------------------
@@ -101,7 +102,7 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 { 
     Mail *mail = new Mail(pktHdr, mailHdr, data); 
 
-    messages->Append((void *)mail);	// put on the end of the list of 
+    messages->AppendLink(&mail->link);	// put on the end of the list of 
 					// arrived messages, and wake up 
 					// any waiters
 }
@@ -176,8 +177,9 @@ static void WriteDone(int arg)
 PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 {
 // First, initialize the synchronization with the interrupt handlers
-    messageAvailable = new Semaphore("message available", 0);
-    messageSent = new Semaphore("message sent", 0);
+    messageAvailable = new Semaphore("message available", 0, 
+					BlockedOnNetwork);
+    messageSent = new Semaphore("message sent", 0, BlockedOnNetwork);
     sendLock = new Lock("message send lock");
 
 // Second, initialize the mailboxes
@@ -68,6 +68,7 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+     ListElement link;		// to put it in a mailbox
 };
 
 // The following class defines a single mailbox, or temporary storage
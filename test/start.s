@@ -130,6 +130,14 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl SetTickets
+	.ent	SetTickets
+SetTickets:
+	addiu $2,$0,SC_SetTickets
+	syscall
+	j	$31
+	.end SetTickets
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,124 @@
+// alarm.cc 
+//	Routines to put threads to sleep for a while, and wake them up
+//	when their time is up.  See alarm.h for an overview.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "alarm.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// AlarmHandler
+// 	Interrupt handler for the alarm.  Dummy function because C++ 
+//	does not allow a pointer to a member function.
+//
+//	"arg" is the Alarm whose interrupt it is.
+//----------------------------------------------------------------------
+
+static void
+AlarmHandler(int arg)
+{
+    Alarm *alarm = (Alarm *) arg;
+
+    alarm->Expire();
+}
+
+//----------------------------------------------------------------------
+// Alarm::Alarm
+// 	Initialize the alarm, with no threads asleep, and so no interrupt
+//	pending.
+//----------------------------------------------------------------------
+
+Alarm::Alarm()
+{
+    sleepers = new List;
+    armedFor = -1;
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+// 	De-allocate the alarm.  Any interrupt still pending had better
+//	not fire afterwards!
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    delete sleepers;
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep for at least "howLong" ticks of
+//	simulated time.  If it is due before anyone else asleep, the
+//	alarm interrupt has to go off earlier.
+//
+//	The thread is linked into the queue of sleepers through its 
+//	"queueLink", since it is not on any other list while it sleeps.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int howLong)
+{
+    IntStatus oldLevel;
+    int when;
+
+    if (howLong <= 0)
+	return;
+    oldLevel = interrupt->SetLevel(IntOff);
+    when = stats->totalTicks + howLong;
+    DEBUG('t', "Thread \"%s\" sleeping until time %d\n", 
+	    currentThread->getName(), when);
+    sleepers->SortedInsertLink(&currentThread->queueLink, when);
+    if ((armedFor < 0) || (when < armedFor))
+	Arm(when);
+    currentThread->Sleep(BlockedOnAlarm);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::Expire
+// 	Called when an alarm interrupt goes off: wake up every thread 
+//	whose time is up.  Then, if this was the interrupt we were waiting
+//	for, and anyone is still asleep, schedule the next one.
+//
+//	An interrupt that is no longer wanted, because someone asked to
+//	wake up earlier and we scheduled another, can't be cancelled; when
+//	it goes off, it wakes anyone who is due, and otherwise does nothing.
+//----------------------------------------------------------------------
+
+void
+Alarm::Expire()
+{
+    int now = stats->totalTicks;
+    int when;
+    Thread *thread;
+
+    while ((sleepers->SortedPeek(&when) != NULL) && (when <= now)) {
+	thread = (Thread *) sleepers->SortedRemove(NULL);
+	DEBUG('t', "Waking up thread \"%s\" at time %d\n", 
+		thread->getName(), now);
+	scheduler->ReadyToRun(thread);
+    }
+    if (armedFor > now)			// a stale interrupt
+	return;
+    armedFor = -1;
+    if (sleepers->SortedPeek(&when) != NULL)
+	Arm(when);
+}
+
+//----------------------------------------------------------------------
+// Alarm::Arm
+// 	Schedule an alarm interrupt for time "when", which must be in the
+//	future.
+//----------------------------------------------------------------------
+
+void
+Alarm::Arm(int when)
+{
+    armedFor = when;
+    interrupt->Schedule(AlarmHandler, (int) this, when - stats->totalTicks,
+				AlarmInt);
+}
@@ -0,0 +1,49 @@
+// alarm.h 
+//	Data structures for letting threads sleep for a while.
+//
+//	A thread that wants to wait for some amount of simulated time 
+//	-- for instance, a daemon that wakes up periodically to write 
+//	back dirty blocks -- could loop calling Yield until the time is
+//	up, but that keeps it on the ready list, burning CPU, the whole
+//	time.  Instead, it calls Alarm::WaitUntil, which puts it to sleep
+//	on a queue of sleepers, ordered by when they should wake up.
+//
+//	The alarm keeps one interrupt pending, for when the first sleeper
+//	is due; that interrupt wakes up every sleeper whose time is up,
+//	and arranges the next interrupt, if anyone is still asleep.  When
+//	no one is asleep, no interrupt is pending.  Think of it as a 
+//	programmable one-shot timer, as opposed to the periodic Timer 
+//	device that gives out time slices.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include "copyright.h"
+#include "list.h"
+
+// The following class defines the alarm clock service.
+
+class Alarm {
+  public:
+    Alarm();				// Initialize, with no one asleep
+    ~Alarm();				// De-allocate; no one may be asleep
+
+    void WaitUntil(int howLong);	// Put the current thread to sleep
+					// for at least "howLong" ticks
+
+    void Expire();			// Wake up the threads whose time is
+					// up (called by the interrupt handler)
+
+  private:
+    List *sleepers;			// threads asleep, sorted by when 
+					// they should wake up
+    int armedFor;			// when the next alarm interrupt is 
+					// due; -1 if none is pending
+    void Arm(int when);			// Schedule an interrupt at "when"
+};
+
+#endif // ALARM_H
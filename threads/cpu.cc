@@ -0,0 +1,252 @@
+// cpu.cc 
+//	Routines to simulate a symmetric multiprocessor, by switching the
+//	host between the simulated CPUs.  See cpu.h for an overview.
+//
+// 	These routines assume that interrupts are already disabled.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "cpu.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Cpu::Cpu
+// 	Initialize a CPU, with nothing to run.
+//
+//	"cpuId" -- which CPU it is
+//	"policy", "levels" -- how its scheduler picks threads to run
+//----------------------------------------------------------------------
+
+Cpu::Cpu(int cpuId, SchedulerPolicy policy, int levels)
+{
+    id = cpuId;
+    scheduler = new Scheduler(policy, levels);
+    running = NULL;
+    clock = 0;
+    cpuStats = stats->NewCpu(cpuId);
+    interrupted = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Cpu::~Cpu
+// 	De-allocate a CPU.
+//----------------------------------------------------------------------
+
+Cpu::~Cpu()
+{
+    delete scheduler;
+}
+
+//----------------------------------------------------------------------
+// Cpu::Advance
+// 	Count "ticks" of time that the CPU spent running, and move 
+//	simulated time forward, if the CPU is now further ahead than 
+//	any other.
+//----------------------------------------------------------------------
+
+void
+Cpu::Advance(int ticks)
+{
+    clock += ticks;
+    cpuStats->busyTicks += ticks;
+    if (clock > stats->totalTicks)
+	stats->totalTicks = clock;
+}
+
+//----------------------------------------------------------------------
+// Cpu::SendIPI
+// 	Send the CPU an inter-processor interrupt, so that it wakes up
+//	(if it is idle) and looks for a thread to run.
+//----------------------------------------------------------------------
+
+void
+Cpu::SendIPI()
+{
+    DEBUG('t', "Sending an IPI to CPU %d\n", id);
+    interrupted = TRUE;
+    cpuStats->numIPIs++;
+}
+
+//----------------------------------------------------------------------
+// Cpu::IsBusy
+// 	Return TRUE if the CPU has something to do: a thread it was 
+//	running when it last gave up the host, threads on its ready 
+//	queue, or an IPI telling it there is work to steal.
+//----------------------------------------------------------------------
+
+bool
+Cpu::IsBusy()
+{
+    if ((running != NULL) || (scheduler->NumReady() > 0))
+	return TRUE;
+    if (!interrupted)
+	return FALSE;
+    for (int i = 0; i < numCpus; i++)
+	if ((cpus[i] != this) && (cpus[i]->scheduler->NumReady() > 0))
+	    return TRUE;
+    interrupted = FALSE;		// the work has gone already
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Cpu::Enter
+// 	The host is about to run this CPU: take any IPI, and if the CPU 
+//	was idle, it has been idle until now.
+//----------------------------------------------------------------------
+
+void
+Cpu::Enter()
+{
+    interrupted = FALSE;
+    if (running == NULL)
+	CatchUp();
+}
+
+//----------------------------------------------------------------------
+// Cpu::CatchUp
+// 	An idle CPU's clock stands still; bring it up to the present.
+//----------------------------------------------------------------------
+
+void
+Cpu::CatchUp()
+{
+    if (clock < stats->totalTicks)
+	clock = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// NextCpu
+// 	Return the CPU, other than the current one, that should have the
+//	host next: an idle CPU that has been given work, or else the busy
+//	CPU whose clock is furthest behind.  Ties go to the lowest number.
+//	Return NULL if no other CPU has anything to do.
+//----------------------------------------------------------------------
+
+Cpu *
+NextCpu()
+{
+    Cpu *cpu, *best = NULL;
+
+    for (int i = 0; i < numCpus; i++) {
+	cpu = cpus[i];
+	if ((cpu == currentCpu) || !cpu->IsBusy())
+	    continue;
+	if (cpu->running == NULL)
+	    return cpu;
+	if ((best == NULL) || (cpu->clock < best->clock))
+	    best = cpu;
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// EnterCpu
+// 	Switch the host from the current CPU to "cpu", which must be busy,
+//	and return the thread it should run: the one it was running, or 
+//	if it was idle, the next from its ready queue (or another's).
+//	The caller then calls Scheduler::Run to switch to that thread.
+//
+//	If the current thread is still running (rather than blocking),
+//	the current CPU keeps it, to carry on with when it next has the
+//	host.
+//----------------------------------------------------------------------
+
+Thread *
+EnterCpu(Cpu *cpu)
+{
+    Thread *thread;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    if (currentThread->getStatus() == RUNNING)
+	currentCpu->running = currentThread;
+    else
+	currentCpu->running = NULL;
+    DEBUG('t', "Switching from CPU %d to CPU %d\n", currentCpu->id, cpu->id);
+
+    cpu->Enter();
+    currentCpu = cpu;
+    scheduler = cpu->scheduler;
+    thread = cpu->running;
+    cpu->running = NULL;
+    if (thread == NULL)
+	thread = scheduler->FindNextToRun();
+    ASSERT(thread != NULL);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// CpuTick
+// 	Called after every tick of simulated time when there is more than
+//	one CPU: if the current CPU has got far enough ahead of the others,
+//	or an idle one has been given something to do, switch the host to
+//	that CPU.  We get the host back when it is our turn again.
+//----------------------------------------------------------------------
+
+void
+CpuTick()
+{
+    Cpu *cpu = NextCpu();
+    Thread *next;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    if ((cpu == NULL) 
+	|| ((cpu->running != NULL) && (currentCpu->clock - cpu->clock < CpuSlice)))
+	return;
+    next = EnterCpu(cpu);		// changes "scheduler" to the new CPU's,
+    scheduler->Run(next);		// so call it first
+}
+
+//----------------------------------------------------------------------
+// StealThread
+// 	Called when the CPU of "thief" has nothing of its own to run: take
+//	the first ready thread from the CPU with the most.  Return NULL
+//	if no other CPU has any.
+//----------------------------------------------------------------------
+
+Thread *
+StealThread(Scheduler *thief)
+{
+    Cpu *victim = NULL;
+    int n, most = 0;
+
+    for (int i = 0; i < numCpus; i++) {
+	if (cpus[i]->scheduler == thief)
+	    continue;
+	n = cpus[i]->scheduler->NumReady();
+	if (n > most) {
+	    victim = cpus[i];
+	    most = n;
+	}
+    }
+    if (victim == NULL)
+	return NULL;
+    DEBUG('t', "CPU %d stealing a thread from CPU %d\n", currentCpu->id, 
+	    victim->id);
+    currentCpu->cpuStats->numSteals++;
+    return victim->scheduler->FindNextToRun();
+}
+
+//----------------------------------------------------------------------
+// WakeCpu
+// 	A thread has been put on the ready queue of "home".  If "home" is
+//	idle, send it an IPI, so that it runs the thread.  Otherwise, if 
+//	some CPU is idle, send it one, so that it can steal the thread.
+//----------------------------------------------------------------------
+
+void
+WakeCpu(Cpu *home)
+{
+    if ((home != currentCpu) && (home->running == NULL)) {
+	home->SendIPI();
+	return;
+    }
+    for (int i = 0; i < numCpus; i++)
+	if ((cpus[i] != currentCpu) && (cpus[i] != home) 
+		&& !cpus[i]->IsBusy()) {
+	    cpus[i]->SendIPI();
+	    return;
+	}
+}
@@ -0,0 +1,81 @@
+// cpu.h 
+//	Data structures for simulating a symmetric multiprocessor.
+//
+//	With -smp <n>, Nachos simulates n CPUs sharing memory.  Each CPU
+//	has its own ready queue (its own Scheduler), its own clock, and 
+//	while another CPU has the host, the thread it was running.  There
+//	is still only one host thread of control, so the CPUs take turns,
+//	deterministically: a CPU runs until its clock is CpuSlice ticks
+//	ahead of the CPU that is furthest behind, and then that one runs.
+//	Simulated time -- stats->totalTicks -- is as far as any CPU has 
+//	got, so that n CPUs with work to do get through it up to n times
+//	as fast.
+//
+//	CPUs only take turns when interrupts are being re-enabled (or 
+//	when a thread blocks), so disabling interrupts still gives mutual
+//	exclusion, as it does on a uniprocessor -- as if the kernel held a
+//	giant lock whenever interrupts are off.  Locks that are held with
+//	interrupts on, though, can be contended between CPUs: a SpinLock
+//	(see synch.h) costs the waiting CPU the time it spins.
+//
+//	A thread goes back on the ready queue of the CPU it last ran on.
+//	A CPU with nothing to run is idle until it is sent an 
+//	inter-processor interrupt (IPI): either because a thread that 
+//	last ran there is ready again, or because another CPU has more
+//	work than it can run, which the idle CPU then steals.
+//
+//	Only FIFO scheduling is supported with more than one CPU.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "copyright.h"
+#include "scheduler.h"
+#include "stats.h"
+
+#define MaxCpus		16	// most CPUs we can simulate
+#define CpuSlice	100	// how far ahead of the others a CPU may get,
+				// in ticks, before it has to let them run
+
+// The following class defines one simulated CPU.
+
+class Cpu {
+  public:
+    Cpu(int cpuId, SchedulerPolicy policy, int levels);
+					// Initialize an idle CPU
+    ~Cpu();				// De-allocate it
+
+    int id;				// which CPU
+    Scheduler *scheduler;		// its ready queue
+    Thread *running;			// the thread it is running, while 
+					// another CPU has the host; NULL if
+					// it is idle, or has the host
+    int clock;				// its own simulated time
+    CpuStatistics *cpuStats;		// what it has been doing
+
+    void Advance(int ticks);		// Count time the CPU spent running
+    void SendIPI();			// Interrupt the CPU, so that it 
+					// looks for something to run
+    bool IsBusy();			// Does it have anything to run?
+    void Enter();			// The host is switching to this CPU
+    void CatchUp();			// Bring an idle CPU's clock up to date
+
+  private:
+    bool interrupted;			// has it been sent an IPI?
+};
+
+extern Cpu *NextCpu();			// The CPU that should run next
+extern Thread *EnterCpu(Cpu *cpu);	// Switch the host to "cpu", and
+					// return the thread to run on it
+extern void CpuTick();			// Let another CPU run, if it is 
+					// our turn to stop
+extern Thread *StealThread(Scheduler *thief);
+					// Take a ready thread from another
+					// CPU's queue, for "thief"'s CPU
+extern void WakeCpu(Cpu *home);		// A thread was put on "home"'s 
+					// ready queue; get it run
+#endif // CPU_H
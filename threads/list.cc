@@ -6,6 +6,11 @@
 //	list; it is de-allocated when the item is removed. This means
 //      we don't need to keep a "next" pointer in every object we
 //      want to put on a list.
+//
+//	Since lists are used everywhere (the ready list, semaphore
+//	queues, mailboxes, ...), de-allocated ListElements are kept on
+//	a free list, to be reused rather than allocated again.  Items 
+//	can also bring ListElements of their own (see AppendLink).
 // 
 //     	NOTE: Mutual exclusion must be provided by the caller.
 //  	If you want a synchronized list, you must use the routines 
@@ -17,6 +22,9 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "system.h"
+
+static ListElement *freeElements = NULL;	// ListElements to reuse
 
 //----------------------------------------------------------------------
 // ListElement::ListElement
@@ -32,6 +40,63 @@ ListElement::ListElement(void *itemPtr, int sortKey)
      item = itemPtr;
      key = sortKey;
      next = NULL;	// assume we'll put it at the end of the list 
+     embedded = FALSE;
+}
+
+//----------------------------------------------------------------------
+// ListElement::ListElement
+// 	Initialize a list element that is part of the item it will 
+//	keep track of.  The item has to set "item" to point to itself.
+//----------------------------------------------------------------------
+
+ListElement::ListElement()
+{
+     item = NULL;
+     key = 0;
+     next = NULL;
+     embedded = TRUE;
+}
+
+//----------------------------------------------------------------------
+// NewElement
+// 	Return a list element for "item", reusing a free one if we can.
+//
+//	"item" is the thing to put on the list
+//	"sortKey" is the priority of the item, if any
+//----------------------------------------------------------------------
+
+static ListElement *
+NewElement(void *item, int sortKey)
+{
+    ListElement *element = freeElements;
+
+    if (element == NULL) {
+	if (stats != NULL)
+	    stats->numListAllocs++;
+	return new ListElement(item, sortKey);
+    }
+    if (stats != NULL)
+	stats->numListReuses++;
+    freeElements = element->next;
+    element->item = item;
+    element->key = sortKey;
+    element->next = NULL;
+    return element;
+}
+
+//----------------------------------------------------------------------
+// FreeElement
+// 	Put a list element that is no longer needed on the free list,
+//	unless it belongs to the item it was keeping track of.
+//----------------------------------------------------------------------
+
+static void
+FreeElement(ListElement *element)
+{
+    if (element->embedded)
+	return;
+    element->next = freeElements;
+    freeElements = element;
 }
 
 //----------------------------------------------------------------------
@@ -67,8 +132,6 @@ List::~List()
 //      Append an "item" to the end of the list.
 //      
 //	Allocate a ListElement to keep track of the item.
-//      If the list is empty, then this will be the only element.
-//	Otherwise, put it at the end.
 //
 //	"item" is the thing to put on the list, it can be a pointer to 
 //		anything.
@@ -77,8 +140,37 @@ List::~List()
 void
 List::Append(void *item)
 {
-    ListElement *element = new ListElement(item, 0);
+    AppendElement(NewElement(item, 0));
+}
+
+//----------------------------------------------------------------------
+// List::AppendLink
+//      Append an item to the end of the list, using the ListElement
+//	embedded in it, rather than allocating one.
+//
+//	"link" is the item's ListElement; "link->item" is the item
+//----------------------------------------------------------------------
+
+void
+List::AppendLink(ListElement *link)
+{
+    ASSERT(link->embedded && (link->item != NULL));
+    if (stats != NULL)
+	stats->numListLinks++;
+    link->next = NULL;
+    AppendElement(link);
+}
+
+//----------------------------------------------------------------------
+// List::AppendElement
+//      Put a list element at the end of the list.
+//      If the list is empty, then this will be the only element.
+//	Otherwise, put it after the last one.
+//----------------------------------------------------------------------
 
+void
+List::AppendElement(ListElement *element)
+{
     if (IsEmpty()) {		// list is empty
 	first = element;
 	last = element;
@@ -104,7 +196,7 @@ List::Append(void *item)
 void
 List::Prepend(void *item)
 {
-    ListElement *element = new ListElement(item, 0);
+    ListElement *element = NewElement(item, 0);
 
     if (IsEmpty()) {		// list is empty
 	first = element;
@@ -169,9 +261,6 @@ List::IsEmpty()
 //	sorted in increasing order by "sortKey".
 //      
 //	Allocate a ListElement to keep track of the item.
-//      If the list is empty, then this will be the only element.
-//	Otherwise, walk through the list, one element at a time,
-//	to find where the new item should be placed.
 //
 //	"item" is the thing to put on the list, it can be a pointer to 
 //		anything.
@@ -181,7 +270,41 @@ List::IsEmpty()
 void
 List::SortedInsert(void *item, int sortKey)
 {
-    ListElement *element = new ListElement(item, sortKey);
+    InsertElement(NewElement(item, sortKey));
+}
+
+//----------------------------------------------------------------------
+// List::SortedInsertLink
+//      Insert an item into a sorted list, using the ListElement 
+//	embedded in it, rather than allocating one.
+//
+//	"link" is the item's ListElement; "link->item" is the item
+//	"sortKey" is the priority of the item.
+//----------------------------------------------------------------------
+
+void
+List::SortedInsertLink(ListElement *link, int sortKey)
+{
+    ASSERT(link->embedded && (link->item != NULL));
+    if (stats != NULL)
+	stats->numListLinks++;
+    link->key = sortKey;
+    link->next = NULL;
+    InsertElement(link);
+}
+
+//----------------------------------------------------------------------
+// List::InsertElement
+//      Put a list element into the list, in order of its key.
+//      If the list is empty, then this will be the only element.
+//	Otherwise, walk through the list, one element at a time,
+//	to find where the new element should be placed.
+//----------------------------------------------------------------------
+
+void
+List::InsertElement(ListElement *element)
+{
+    int sortKey = element->key;
     ListElement *ptr;		// keep track
 
     if (IsEmpty()) {	// if list is empty, put
@@ -237,11 +360,33 @@ List::SortedRemove(int *keyPtr)
     }
     if (keyPtr != NULL)
         *keyPtr = element->key;
-    delete element;
+    FreeElement(element);
     numInList--;
     return thing;
 }
 
+//----------------------------------------------------------------------
+// List::SortedPeek
+//      Look at the first "item" on a sorted list, leaving it there.
+// 
+// Returns:
+//	Pointer to the first item, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of the item.
+//
+//	"keyPtr" is a pointer to the location in which to store the 
+//		priority of the item.
+//----------------------------------------------------------------------
+
+void *
+List::SortedPeek(int *keyPtr)
+{
+    if (IsEmpty()) 
+	return NULL;
+    if (keyPtr != NULL)
+        *keyPtr = first->key;
+    return first->item;
+}
+
 
 
 void
@@ -264,7 +409,7 @@ List::Remove(void *item)
 		if (prev->next == NULL) {
 		    last = prev;
 		}
-		delete ptr;
+		FreeElement(ptr);
 		numInList--;
 		break;
 	    }
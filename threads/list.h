@@ -23,15 +23,26 @@
 //
 // Internal data structures kept public so that List operations can
 // access them directly.
+//
+// Normally the List allocates a ListElement for each item, and frees
+// it (for reuse) when the item is removed.  An item that is put on
+// lists often, like a Thread, can instead embed a ListElement of its
+// own, and be put on a list with AppendLink or SortedInsertLink; then
+// nothing is allocated at all.  An item can only be on one list at a
+// time this way.
 
 class ListElement {
    public:
      ListElement(void *itemPtr, int sortKey);	// initialize a list element
+     ListElement();		// initialize a list element to be embedded
+				// in an item; set "item" before using it
 
      ListElement *next;		// next element on list, 
 				// NULL if this is the last
      int key;		    	// priority, for a sorted list
      void *item; 	    	// pointer to item on the list
+     bool embedded;		// part of the item, rather than allocated
+				// by the List?
 };
 
 // The following class defines a "list" -- a singly linked list of
@@ -61,11 +72,23 @@ class List {
     // Routines to put/get items on/off list in order (sorted by key)
     void SortedInsert(void *item, int sortKey);	// Put item into list
     void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
+    void *SortedPeek(int *keyPtr);		// Return first item on list,
+						// without removing it
+
+    // Routines to put items on the list using a ListElement embedded
+    // in the item, which must point "item" back to it; take them off
+    // with Remove or SortedRemove, as usual
+    void AppendLink(ListElement *link);
+    void SortedInsertLink(ListElement *link, int sortKey);
 
   private:
     ListElement *first;  	// Head of the list, NULL if list is empty
     ListElement *last;		// Last element of list
     int numInList;		// number of elements in list
+
+    void AppendElement(ListElement *element);	// Put an element at the end
+    void InsertElement(ListElement *element);	// Put an element in order
+						// of its key
 };
 
 #endif // LIST_H
@@ -16,22 +16,49 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-sched <policy> -mlfqlevels <# levels> -ts
+//		-stacksize <# words> -guardstacks -smp <# cpus>
+//		-s -decodecache -blocks -x <nachos file> -c <consoleIn> <consoleOut>
+//		-tlb <# entries> -tlbways <# ways> -tlbpolicy <policy>
+//		-vmpolicy <policy>
+//		-f -cachesize <# sectors> -readahead <# sectors>
+//		-disksched <policy>
+//		-cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -l -D -t -ds
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sched picks the scheduling policy: fifo, mlfq (multilevel
+//	feedback queue), or the proportional-share stride or lottery
+//    -mlfqlevels sets the number of MLFQ priority levels (1 to 8)
+//    -ts prints, at the end, where each thread's time went: running,
+//	ready to run, or blocked (and on what)
+//    -stacksize sets the size of thread stacks, in words
+//    -guardstacks puts an unmapped page on either side of each thread 
+//	stack, to catch overflows
+//    -smp simulates a multiprocessor with this many CPUs (1 to 16; 
+//	FIFO scheduling only)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -decodecache keeps decoded user instructions, to speed up simulation
+//    -blocks runs user programs a basic block at a time, also for speed
 //    -x runs a user program
 //    -c tests the console
 //
+//  USE_TLB
+//    -tlb sets the number of TLB entries (4 to 512)
+//    -tlbways makes the TLB set-associative, with this many entries per set
+//    -tlbpolicy picks TLB entries to replace: fifo, random, lru, or clock
+//
+//  VM
+//    -vmpolicy picks pages to evict: fifo, clock, eclock (enhanced clock),
+//	aging, or wset (working set)
+//
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
@@ -40,6 +67,14 @@
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -ds compares the disk scheduling policies, with random reads by
+//	many threads at once
+//    -cachesize sets the number of sectors in the disk buffer cache 
+//	(0 for none)
+//    -readahead sets the most sectors to read ahead of a file that is 
+//	being read sequentially (0 for none)
+//    -disksched picks the order to serve waiting disk requests: fifo, 
+//	sstf (shortest seek time first), or clook
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -68,7 +103,7 @@ extern int testnum;
 // External functions used by this file
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
-extern void Print(char *file), PerformanceTest(void);
+extern void Print(char *file), PerformanceTest(void), DiskSchedTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 
@@ -154,6 +189,8 @@ main(int argc, char **argv)
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-ds")) {	// disk scheduling test
+            DiskSchedTest();
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -167,6 +204,9 @@ main(int argc, char **argv)
         }
 #endif // NETWORK
     }
+#ifdef FILESYS
+    synchDisk->Sync();		// write back anything still in the cache
+#endif
 
     currentThread->Finish();	// NOTE: if the procedure "main" 
 				// returns, then the program "nachos"
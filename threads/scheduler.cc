@@ -18,8 +18,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	By default, a very simple implementation -- no priorities, 
+//	straight FIFO.  A multilevel feedback queue can be selected 
+//	instead (see scheduler.h).
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -29,14 +30,31 @@
 #include "scheduler.h"
 #include "system.h"
 
+#define MlfqQuantum	TimerTicks	// the time slice at the top level;
+					// each level down, it doubles
+#define MlfqBoostInterval (50 * TimerTicks)	// how often to boost every
+					// thread back to the top level
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads to empty.
+//
+//	"policy" -- how to choose which thread to run
+//	"levels" -- the number of priority levels, for MLFQ
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulerPolicy schedPolicy, int levels)
 { 
-    readyList = new List; 
+    policy = schedPolicy;
+    numLevels = (policy == MlfqScheduling) ? levels : 1;
+    ASSERT((numLevels >= 1) && (numLevels <= MaxMlfqLevels));
+    readyList = new List *[numLevels];
+    for (int i = 0; i < numLevels; i++)
+	readyList[i] = new List; 
+    sliceStart = 0;
+    lastBoost = 0;
+    boostEpoch = 0;
+    globalPass = 0;
 } 
 
 //----------------------------------------------------------------------
@@ -46,7 +64,9 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < numLevels; i++)
+	delete readyList[i]; 
+    delete [] readyList;
 } 
 
 //----------------------------------------------------------------------
@@ -54,22 +74,126 @@ Scheduler::~Scheduler()
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
+//	With MLFQ, a thread goes back to the top level if there has been 
+//	a boost since it last ran.  A thread woken up by an interrupt 
+//	handler was waiting for a device, so it moves up a level; if it
+//	is now above the running thread, it runs as soon as the handler 
+//	returns.
+//
+//	With stride scheduling, a thread that has been blocked for a 
+//	while must not get to make up for lost time, so its pass is
+//	brought up to date.
+//
+//	A thread holding a lock that others are waiting for is queued 
+//	at their priority, if it is better than its own (see 
+//	Thread::EffectiveLevel).
+//
+//	With more than one CPU, a thread goes on the ready list of the CPU 
+//	it last ran on, which may not be ours, and that CPU (or an idle 
+//	one, to steal the thread) is woken up.
+//
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
 
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
+    Cpu *home;
+
+    if (numCpus > 1) {
+	home = cpus[thread->cpu];
+	if (home->scheduler != this) {
+	    home->scheduler->ReadyToRun(thread);
+	    return;
+	}
+	DEBUG('t', "Putting thread %s on ready list of CPU %d.\n", 
+		thread->getName(), home->id);
+	thread->setStatus(READY);
+	readyList[0]->AppendLink(&thread->queueLink);
+	WakeCpu(home);
+	return;
+    }
+
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
+    if (policy == MlfqScheduling) {
+	if (thread->schedEpoch != boostEpoch) {
+	    thread->schedLevel = 0;
+	    thread->schedEpoch = boostEpoch;
+	} else if ((thread->getStatus() == BLOCKED) && interrupt->InHandler()
+		    && (thread->schedLevel > 0))
+	    thread->schedLevel--;
+	if (interrupt->InHandler() && (interrupt->getStatus() != IdleMode)
+		&& (thread->EffectiveLevel() < currentThread->EffectiveLevel()))
+	    interrupt->YieldOnReturn();
+    } else if ((policy == StrideScheduling) 
+		&& ((int) (thread->pass - globalPass) < 0))
+	thread->pass = globalPass;
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    readyList[Level(thread)]->AppendLink(&thread->queueLink);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Requeue
+// 	The priority of "thread", which is on the ready list, has changed
+//	because of a priority donation; with MLFQ, move it to the ready 
+//	list for its new level.  The other policies look at the thread's
+//	tickets each time they choose, so there is nothing to do.
+//
+//	"oldLevel" is the level the thread was queued at.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Requeue(Thread *thread, int oldLevel)
+{
+    ASSERT(thread->getStatus() == READY);
+    if ((policy != MlfqScheduling) || (Level(thread) == oldLevel))
+	return;
+    readyList[oldLevel]->Remove((void *)thread);
+    readyList[Level(thread)]->AppendLink(&thread->queueLink);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HigherPriority
+// 	Return TRUE if thread "a" should get to run before thread "b":
+//	with MLFQ, if it is at a higher level; with stride and lottery
+//	scheduling, if it has more tickets.  With FIFO, nobody is ahead
+//	of anybody.  Used to decide who gets a lock next.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::HigherPriority(Thread *a, Thread *b)
+{
+    switch (policy) {
+      case MlfqScheduling:
+	return (a->EffectiveLevel() < b->EffectiveLevel());
+      case StrideScheduling:
+      case LotteryScheduling:
+	return (a->EffectiveTickets() > b->EffectiveTickets());
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Level
+// 	Return which ready list "thread" belongs on.
+//----------------------------------------------------------------------
+
+int
+Scheduler::Level(Thread *thread)
+{
+    return (policy == MlfqScheduling) ? thread->EffectiveLevel() : 0;
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
-//	If there are no ready threads, return NULL.
+// 	Return the next thread to be scheduled onto the CPU: the first
+//	one at the highest priority level that has any; or with stride
+//	scheduling, the one with the lowest pass; or with lottery
+//	scheduling, the winner of a lottery.
+//	If there are no ready threads, return NULL -- or with more than 
+//	one CPU, steal a thread from another CPU's ready list.
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -77,7 +201,217 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    Thread *next;
+
+    switch (policy) {
+      case StrideScheduling:
+	next = LowestPass();
+	break;
+      case LotteryScheduling:
+	next = DrawLottery(NULL);
+	break;
+      default:
+	for (int i = 0; i < numLevels; i++)
+	    if (!readyList[i]->IsEmpty())
+		return (Thread *)readyList[i]->Remove();
+	return (numCpus > 1) ? StealThread(this) : NULL;
+    }
+    if (next != NULL)
+	readyList[0]->Remove((void *)next);
+    return next;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NumReady
+// 	Return the number of threads on the ready list.
+//----------------------------------------------------------------------
+
+int
+Scheduler::NumReady()
+{
+    int n = 0;
+
+    for (int i = 0; i < numLevels; i++)
+	n += readyList[i]->NumInList();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TimerTick
+// 	Called by the timer interrupt handler.  Returns TRUE if the 
+//	running thread should yield the CPU when the handler returns.
+//
+//	With FIFO, the timer is only running to make threads yield at 
+//	random, so always yield.  With MLFQ, boost every thread if it is
+//	time to; then, if the running thread has used up its time slice,
+//	move it down a level and start it on a new slice.  It only has
+//	to yield if some other thread is ready at its level or above.
+//
+//	With stride scheduling, the running thread yields if some ready
+//	thread is now behind it; with lottery scheduling, if it loses
+//	the lottery.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::TimerTick()
+{
+    Thread *next;
+    int level;
+
+    switch (policy) {
+      case FifoScheduling:
+	return TRUE;
+      case StrideScheduling:
+	Charge(currentThread);
+	next = LowestPass();
+	return (next != NULL) && ((int) (next->pass - currentThread->pass) < 0);
+      case LotteryScheduling:
+	return (DrawLottery(currentThread) != currentThread);
+      default:
+	break;
+    }
+
+    if (stats->totalTicks - lastBoost >= MlfqBoostInterval)
+	Boost();
+    level = currentThread->schedLevel;
+    if (stats->totalTicks - sliceStart < Quantum(level))
+	return FALSE;
+    if (level < numLevels - 1)
+	level = ++currentThread->schedLevel;
+    DEBUG('t', "Thread \"%s\" used its time slice, now at level %d\n",
+	    currentThread->getName(), level);
+    sliceStart = stats->totalTicks;
+    level = currentThread->EffectiveLevel();
+    for (int i = 0; i <= level; i++)
+	if (!readyList[i]->IsEmpty())
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Quantum
+// 	Return the length of an MLFQ time slice at priority "level".
+//	Lower levels get longer slices, since their threads are the
+//	ones that compute for a long time without blocking.
+//----------------------------------------------------------------------
+
+int
+Scheduler::Quantum(int level)
+{
+    return MlfqQuantum << level;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move every ready thread, and the running thread, back to the top 
+//	priority level, so that threads that have dropped to the bottom 
+//	get to run.  Blocked threads are moved when they become ready,
+//	since their "schedEpoch" is out of date.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost()
+{
+    Thread *thread;
+
+    DEBUG('t', "Boosting every thread to the top priority level\n");
+    lastBoost = stats->totalTicks;
+    boostEpoch++;
+    for (int i = 1; i < numLevels; i++)
+	while ((thread = (Thread *)readyList[i]->Remove()) != NULL) {
+	    thread->schedLevel = 0;
+	    thread->schedEpoch = boostEpoch;
+	    readyList[0]->AppendLink(&thread->queueLink);
+	}
+    currentThread->schedLevel = 0;
+    currentThread->schedEpoch = boostEpoch;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Advance the pass of "thread", which has been running since 
+//	"sliceStart", by its stride for every TimerTicks it has run.  
+//	(Splitting the stride this way keeps the product from 
+//	overflowing.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    int stride = StrideOne / thread->EffectiveTickets();
+    int elapsed = stats->totalTicks - sliceStart;
+
+    thread->pass += (stride / TimerTicks) * elapsed 
+			+ ((stride % TimerTicks) * elapsed) / TimerTicks;
+    sliceStart = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::LowestPass
+// 	Return the ready thread with the lowest pass, without taking it
+//	off the ready list; NULL if no thread is ready.  Ties go to the
+//	thread that has been waiting longest.
+//
+//	Passes are compared by their difference, so that it doesn't
+//	matter if they wrap around.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::LowestPass()
+{
+    List *ready = readyList[0];
+    Thread *thread, *best = NULL;
+    int n = ready->NumInList();
+
+    for (int i = 0; i < n; i++) {	// look at each thread, leaving the
+	thread = (Thread *)ready->Remove();	// list in the same order
+	if ((best == NULL) || ((int) (thread->pass - best->pass) < 0))
+	    best = thread;
+	ready->AppendLink(&thread->queueLink);
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::DrawLottery
+// 	Hold a lottery among the ready threads, and "alsoRunning" (the 
+//	running thread) if it isn't NULL: each has as many chances as it
+//	has tickets.  Return the winner, without taking it off the ready
+//	list; NULL if there is no one to choose.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::DrawLottery(Thread *alsoRunning)
+{
+    List *ready = readyList[0];
+    Thread *thread, *winner = NULL;
+    int n = ready->NumInList();
+    int total = 0, draw, i;
+
+    for (i = 0; i < n; i++) {		// count the tickets
+	thread = (Thread *)ready->Remove();
+	total += thread->EffectiveTickets();
+	ready->AppendLink(&thread->queueLink);
+    }
+    if (alsoRunning != NULL)
+	total += alsoRunning->EffectiveTickets();
+    if (total == 0)
+	return NULL;
+
+    draw = Random() % total;		// then find who holds ticket "draw"
+    if (alsoRunning != NULL) {
+	if (draw < alsoRunning->EffectiveTickets())
+	    winner = alsoRunning;
+	draw -= alsoRunning->EffectiveTickets();
+    }
+    for (i = 0; i < n; i++) {
+	thread = (Thread *)ready->Remove();
+	if ((winner == NULL) && (draw < thread->EffectiveTickets()))
+	    winner = thread;
+	draw -= thread->EffectiveTickets();
+	ready->AppendLink(&thread->queueLink);
+    }
+    return winner;
 }
 
 //----------------------------------------------------------------------
@@ -87,7 +421,9 @@ Scheduler::FindNextToRun ()
 //	dependent context switch routine, SWITCH.
 //
 //      Note: we assume the state of the previously running thread has
-//	already been changed from running to blocked or ready (depending).
+//	already been changed from running to blocked or ready (depending);
+//	if it is still running, the host is switching to another CPU, and
+//	the old thread stays on the CPU it was running on (see EnterCpu).
 // Side effect:
 //	The global variable currentThread becomes nextThread.
 //
@@ -109,8 +445,26 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    if (policy == StrideScheduling) {	    // charge the old thread for
+	Charge(oldThread);		    // its time, and catch up with
+	globalPass = nextThread->pass;	    // the new one
+    }
+
+    if (oldThread->getStatus() != RUNNING) { // not just changing CPUs
+	stats->numContextSwitches++;
+	if (oldThread->getStatus() == READY)	// it didn't block
+	    oldThread->account->numYields++;
+    }
+    if (nextThread->getStatus() != RUNNING) { // not carrying on where it
+	nextThread->account->numDispatches++;	// left off, on its CPU
+	nextThread->account->lastDispatch = stats->totalTicks;
+	nextThread->cpu = currentCpu->id;
+	currentCpu->cpuStats->numDispatches++;
+    }
+
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+    sliceStart = stats->totalTicks;	    // with a new time slice
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
@@ -150,5 +504,28 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i = 0; i < numLevels; i++)
+	readyList[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+}
+
+//----------------------------------------------------------------------
+// SchedulerNamed
+// 	Return the scheduling policy with the given name, as given on
+//	the command line.
+//----------------------------------------------------------------------
+
+SchedulerPolicy
+SchedulerNamed(char *name)
+{
+    if (!strcmp(name, "fifo"))
+	return FifoScheduling;
+    else if (!strcmp(name, "mlfq"))
+	return MlfqScheduling;
+    else if (!strcmp(name, "stride"))
+	return StrideScheduling;
+    else if (!strcmp(name, "lottery"))
+	return LotteryScheduling;
+    printf("Unknown scheduling policy \"%s\"\n", name);
+    ASSERT(FALSE);
+    return FifoScheduling;
 }
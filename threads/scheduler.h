@@ -13,24 +13,88 @@
 #include "list.h"
 #include "thread.h"
 
+// The scheduling policies we support:
+//
+//	FIFO -- a single ready list, run in order; threads only give up
+//		the CPU when they block or yield (or with -rs, at random)
+//	MLFQ -- multilevel feedback queue: a ready list per priority
+//		level, highest (0) first.  A thread that uses up its time
+//		slice drops a level, and lower levels get longer slices;
+//		a thread that blocks keeps its level, and one woken up by
+//		an I/O interrupt moves up a level.  Every so often, every
+//		thread is boosted back to the top level, so that threads
+//		at the bottom aren't starved.
+//	stride -- proportional share: each thread gets CPU time in
+//		proportion to its tickets.  A thread's "pass" advances 
+//		by its stride (StrideOne / tickets) for every time slice
+//		it runs, and the thread with the lowest pass runs next.
+//	lottery -- proportional share, at random: each time, hold a 
+//		lottery, in which each ready thread has its tickets
+//
+// With MLFQ, stride and lottery, the timer is always running, to 
+// give threads time slices.
+
+enum SchedulerPolicy { FifoScheduling, MlfqScheduling, StrideScheduling,
+		       LotteryScheduling };
+
+#define MaxMlfqLevels	8	// most priority levels for MLFQ
+#define MlfqLevels	3	// priority levels unless told otherwise
+#define StrideOne	(1 << 16) // stride of a thread with one ticket
+
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
 
 class Scheduler {
   public:
-    Scheduler();			// Initialize list of ready threads 
+    Scheduler(SchedulerPolicy policy, int levels);
+					// Initialize list of ready threads;
+					// "levels" is the # of MLFQ levels
     ~Scheduler();			// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
+    void Requeue(Thread *thread, int oldLevel);
+					// A ready thread's priority changed
+    bool HigherPriority(Thread *a, Thread *b);
+					// Should "a" run before "b"?
     Thread* FindNextToRun();		// Dequeue first thread on the ready 
 					// list, if any, and return thread.
+    int NumReady();			// How many threads are ready?
     void Run(Thread* nextThread);	// Cause nextThread to start running
+    bool TimerTick();			// Called on each timer interrupt; 
+					// TRUE if the running thread should 
+					// give up the CPU
     void Print();			// Print contents of ready list
+
+    bool NeedsTimer() { return (policy != FifoScheduling); }
+					// Does the policy need time slices?
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    SchedulerPolicy policy;	// how to choose the next thread
+    int numLevels;		// # of priority levels; 1 for FIFO
+    List **readyList;  		// queues of threads that are ready to run,
+				// but not running, one per priority level
+    int sliceStart;		// MLFQ: when the running thread's time
+				// slice started
+    int lastBoost;		// MLFQ: when we last boosted every thread
+    int boostEpoch;		// MLFQ: # of boosts so far
+    unsigned int globalPass;	// stride: the pass of the thread we last
+				// dispatched; threads that become ready
+				// start from here
+
+    int Level(Thread *thread);	// which ready list "thread" goes on
+    int Quantum(int level);	// MLFQ: the time slice for a level
+    void Boost();		// MLFQ: move every thread to the top level
+    void Charge(Thread *thread);// stride: advance the pass of "thread"
+				// for the time it has run
+    Thread *LowestPass();	// stride: the ready thread to run next
+    Thread *DrawLottery(Thread *alsoRunning);
+				// lottery: pick a ready thread, or 
+				// "alsoRunning", at random by tickets
 };
 
+extern SchedulerPolicy SchedulerNamed(char *name);
+				// Parse "fifo", "mlfq", "stride" or 
+				// "lottery" (for -sched)
+
 #endif // SCHEDULER_H
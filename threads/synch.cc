@@ -1,8 +1,7 @@
 // synch.cc 
 //	Routines for synchronizing threads.  Three kinds of
 //	synchronization routines are defined here: semaphores, locks 
-//   	and condition variables (the implementation of the last two
-//	are left to the reader).
+//   	and condition variables.
 //
 // Any implementation of a synchronization routine needs some
 // primitive atomic operation.  We assume Nachos is running on
@@ -25,19 +24,42 @@
 #include "synch.h"
 #include "system.h"
 
+#define MaxDonationDepth	8	// how far to pass priority along a
+					// chain of threads waiting for locks
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
 //
 //	"debugName" is an arbitrary name, useful for debugging.
 //	"initialValue" is the initial value of the semaphore.
+//	"why" is what threads waiting on the semaphore are really waiting
+//		for, so that the time they spend blocked can be charged to
+//		it (see ThreadStatistics)
 //----------------------------------------------------------------------
 
 Semaphore::Semaphore(char* debugName, int initialValue)
+{
+    Setup(debugName, initialValue, BlockedOnSemaphore);
+}
+
+Semaphore::Semaphore(char* debugName, int initialValue, ThreadActivity why)
+{
+    Setup(debugName, initialValue, why);
+}
+
+//----------------------------------------------------------------------
+// Semaphore::Setup
+// 	The work of the constructors.
+//----------------------------------------------------------------------
+
+void
+Semaphore::Setup(char* debugName, int initialValue, ThreadActivity why)
 {
     name = debugName;
     value = initialValue;
     queue = new List;
+    waitingFor = why;
 }
 
 //----------------------------------------------------------------------
@@ -67,8 +89,8 @@ Semaphore::P()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
-	currentThread->Sleep();
+	queue->AppendLink(&currentThread->queueLink);	// so go to sleep
+	currentThread->Sleep(waitingFor);
     } 
     value--; 					// semaphore available, 
 						// consume its value
@@ -97,16 +119,520 @@ Semaphore::V()
     (void) interrupt->SetLevel(oldLevel);
 }
 
-// Dummy functions -- so we can compile our later assignments 
-// Note -- without a correct implementation of Condition::Wait(), 
-// the test case in the network assignment won't work!
-Lock::Lock(char* debugName) {}
-Lock::~Lock() {}
-void Lock::Acquire() {}
-void Lock::Release() {}
+//----------------------------------------------------------------------
+// RemoveFirstToRun
+// 	Remove and return the thread on "queue" that the scheduler would
+//	run first -- of threads with the same priority, the one that has
+//	waited longest.  Return NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+static Thread *
+RemoveFirstToRun(List *queue)
+{
+    Thread *thread, *best = NULL;
+    int n = queue->NumInList();
+
+    for (int i = 0; i < n; i++) {	// look at each thread, leaving the
+	thread = (Thread *)queue->Remove();	// queue in the same order
+	if ((best == NULL) || scheduler->HigherPriority(thread, best))
+	    best = thread;
+	queue->AppendLink(&thread->queueLink);
+    }
+    if (best != NULL)
+	queue->Remove((void *)best);
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Lock::Lock
+// 	Initialize a lock, so that it can be used for synchronization.
+//	The lock starts out FREE.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Lock::Lock(char* debugName)
+{
+    name = debugName;
+    owner = NULL;
+    queue = new List;
+    nextHeld = NULL;
+}
+
+//----------------------------------------------------------------------
+// Lock::~Lock
+// 	De-allocate a lock, when no longer needed.  Assume no one
+//	is holding it, or waiting for it!
+//----------------------------------------------------------------------
+
+Lock::~Lock()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Lock::isHeldByCurrentThread
+// 	Return TRUE if the current thread holds the lock.
+//----------------------------------------------------------------------
+
+bool
+Lock::isHeldByCurrentThread()
+{
+    return (owner == currentThread);
+}
+
+//----------------------------------------------------------------------
+// Lock::Acquire
+// 	Wait until the lock is FREE, then take it.  As with Semaphore::P,
+//	this must be atomic, so we disable interrupts.
+//
+//	If we have to wait, we lend the holder our priority first, so
+//	that it can get out of our way.  We don't need to check again 
+//	when we wake up: Release has handed the lock to us.
+//----------------------------------------------------------------------
+
+void
+Lock::Acquire()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(!isHeldByCurrentThread());	// locks aren't recursive
+    stats->numLockAcquires++;
+    if (owner == NULL)
+	GiveTo(currentThread);
+    else {
+	DEBUG('t', "Thread \"%s\" waiting for lock \"%s\"\n",
+		currentThread->getName(), name);
+	stats->numLockWaits++;
+	AddWaiter(currentThread);
+	currentThread->Sleep(BlockedOnLock);
+	ASSERT(isHeldByCurrentThread());
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::Release
+// 	Give up the lock, which the current thread must hold.  If any
+//	threads are waiting for it, hand it straight to the one that 
+//	should run first, and wake it up.
+//
+//	Whatever priority our waiters lent us, we give back.
+//----------------------------------------------------------------------
+
+void
+Lock::Release()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Lock **lp;
+    Thread *next;
+
+    ASSERT(isHeldByCurrentThread());
+    for (lp = &owner->heldLocks; *lp != this; lp = &(*lp)->nextHeld)
+	ASSERT(*lp != NULL);
+    *lp = nextHeld;			// take the lock off our list
+    owner = NULL;
+    UpdateDonations(currentThread);
+
+    next = RemoveFirstToRun(queue);
+    if (next != NULL) {
+	GiveTo(next);
+	UpdateDonations(next);		// those still waiting lend to "next"
+	scheduler->ReadyToRun(next);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::AddWaiter
+// 	Put "thread" on the queue of threads waiting for the lock, which
+//	someone holds, and lend it the thread's priority.  "thread" must
+//	be the current thread, about to go to sleep, or a thread that is
+//	asleep already.  It will be woken up holding the lock.
+//----------------------------------------------------------------------
+
+void
+Lock::AddWaiter(Thread *thread)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(owner != NULL);
+    thread->waitingOn = this;
+    queue->AppendLink(&thread->queueLink);
+    Donate(this);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::GiveTo
+// 	Make "thread" the holder of the lock.
+//----------------------------------------------------------------------
+
+void
+Lock::GiveTo(Thread *thread)
+{
+    owner = thread;
+    thread->waitingOn = NULL;
+    nextHeld = thread->heldLocks;
+    thread->heldLocks = this;
+}
+
+//----------------------------------------------------------------------
+// Lock::UpdateDonations
+// 	Recompute the priority lent to "thread" by the threads waiting for
+//	the locks it holds: the best of their MLFQ levels, and the sum of
+//	their tickets.  If "thread" is on the ready list, it may need to 
+//	move.
+//----------------------------------------------------------------------
+
+void
+Lock::UpdateDonations(Thread *thread)
+{
+    int oldLevel = thread->EffectiveLevel();
+    int level = MaxMlfqLevels, tickets = 0;
+    Thread *waiter;
+    Lock *lock;
+    int n;
+
+    for (lock = thread->heldLocks; lock != NULL; lock = lock->nextHeld) {
+	n = lock->queue->NumInList();
+	for (int i = 0; i < n; i++) {
+	    waiter = (Thread *)lock->queue->Remove();
+	    level = min(level, waiter->EffectiveLevel());
+	    tickets += waiter->EffectiveTickets();
+	    lock->queue->AppendLink(&waiter->queueLink);
+	}
+    }
+    thread->donatedLevel = level;
+    thread->donatedTickets = tickets;
+    DEBUG('t', "Thread \"%s\" now runs at level %d, with %d tickets\n",
+	    thread->getName(), thread->EffectiveLevel(), 
+	    thread->EffectiveTickets());
+    if (thread->getStatus() == READY)
+	scheduler->Requeue(thread, oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::Donate
+// 	A thread has started waiting for "lock"; update the priority of
+//	its holder.  If the holder is itself waiting for a lock, the 
+//	priority passes on to that lock's holder, and so on down the 
+//	chain.  We stop after MaxDonationDepth threads, in case the chain
+//	is a cycle -- a deadlock.
+//----------------------------------------------------------------------
+
+void
+Lock::Donate(Lock *lock)
+{
+    Thread *thread;
+
+    for (int depth = 0; (lock != NULL) && (depth < MaxDonationDepth);
+								depth++) {
+	thread = lock->owner;
+	UpdateDonations(thread);
+	lock = thread->waitingOn;
+    }
+}
+
+//----------------------------------------------------------------------
+// Condition::Condition
+// 	Initialize a condition variable, with no one waiting.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Condition::Condition(char* debugName)
+{
+    name = debugName;
+    queue = new List;
+}
+
+//----------------------------------------------------------------------
+// Condition::~Condition
+// 	De-allocate a condition variable.  Assume no one is waiting.
+//----------------------------------------------------------------------
+
+Condition::~Condition()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Condition::Wait
+// 	Release "conditionLock", which we must hold, and go to sleep 
+//	until signalled; both at once, so that a Signal can't slip in
+//	between.  By the time we wake up, Signal has moved us to the 
+//	lock's queue and Release has handed us the lock.
+//----------------------------------------------------------------------
+
+void
+Condition::Wait(Lock* conditionLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    queue->AppendLink(&currentThread->queueLink);
+    conditionLock->Release();
+    currentThread->Sleep(BlockedOnCondition);
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Condition::Signal
+// 	Wake up the waiting thread that should run first, if there are 
+//	any.  Since we hold "conditionLock", it couldn't run yet anyway,
+//	so it goes straight to the lock's queue instead of the ready list.
+//----------------------------------------------------------------------
+
+void
+Condition::Signal(Lock* conditionLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Thread *thread;
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    thread = RemoveFirstToRun(queue);
+    if (thread != NULL)
+	conditionLock->AddWaiter(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Condition::Broadcast
+// 	Wake up every waiting thread.  They all move to the queue for
+//	"conditionLock", and get it one at a time.
+//----------------------------------------------------------------------
+
+void
+Condition::Broadcast(Lock* conditionLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Thread *thread;
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    while ((thread = (Thread *)queue->Remove()) != NULL)
+	conditionLock->AddWaiter(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers/writers lock, with no one reading or writing.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    lock = new Lock(debugName);
+    readersOk = new Condition(debugName);
+    writersOk = new Condition(debugName);
+    activeReaders = waitingReaders = waitingWriters = admitted = 0;
+    activeWriter = FALSE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate a readers/writers lock.  Assume no one is using it!
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    delete writersOk;
+    delete readersOk;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadAcquire
+// 	Wait until we can read.  If a writer is writing, or waiting to,
+//	we wait until a writer finishes and admits us.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReadAcquire()
+{
+    lock->Acquire();
+    if (activeWriter || (waitingWriters > 0)) {
+	waitingReaders++;
+	do {
+	    readersOk->Wait(lock);
+	} while (admitted == 0);
+	admitted--;
+	waitingReaders--;
+    }
+    activeReaders++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadRelease
+// 	Stop reading.  The last reader out lets in a waiting writer --
+//	unless there are readers on their way in, in which case the last
+//	of them does.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReadRelease()
+{
+    lock->Acquire();
+    ASSERT(activeReaders > 0);
+    activeReaders--;
+    if ((activeReaders == 0) && (admitted == 0) && (waitingWriters > 0))
+	writersOk->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteAcquire
+// 	Wait until no one else is reading or writing, and no readers 
+//	have been let in ahead of us, then start writing.
+//----------------------------------------------------------------------
+
+void
+RWLock::WriteAcquire()
+{
+    lock->Acquire();
+    waitingWriters++;
+    while (activeWriter || (activeReaders > 0) || (admitted > 0))
+	writersOk->Wait(lock);
+    waitingWriters--;
+    activeWriter = TRUE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteRelease
+// 	Stop writing.  If readers are waiting, let all of them in; 
+//	otherwise, let in the next writer.
+//----------------------------------------------------------------------
+
+void
+RWLock::WriteRelease()
+{
+    lock->Acquire();
+    ASSERT(activeWriter);
+    activeWriter = FALSE;
+    if (waitingReaders > 0) {
+	admitted = waitingReaders;
+	readersOk->Broadcast(lock);
+    } else if (waitingWriters > 0)
+	writersOk->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier, with no threads waiting.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"numThreads" is the number of threads that must arrive before
+//		any can go on.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(char* debugName, int numThreads)
+{
+    ASSERT(numThreads > 0);
+    name = debugName;
+    lock = new Lock(debugName);
+    allHere = new Condition(debugName);
+    count = numThreads;
+    arrived = 0;
+    phase = 0;
+}
+
+//----------------------------------------------------------------------
+// Barrier::~Barrier
+// 	De-allocate a barrier.  Assume no one is waiting at it!
+//----------------------------------------------------------------------
+
+Barrier::~Barrier()
+{
+    delete allHere;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait until all "count" threads have called Wait.  The last one to
+//	arrive wakes up the others, and starts the next phase.  We wait
+//	for the phase to change, rather than for "arrived" to reach 
+//	"count", since by the time we run, threads may be arriving for
+//	the next phase.
+//----------------------------------------------------------------------
+
+void
+Barrier::Wait()
+{
+    int myPhase;
+
+    lock->Acquire();
+    myPhase = phase;
+    if (++arrived == count) {
+	arrived = 0;
+	phase++;
+	allHere->Broadcast(lock);
+    } else
+	while (phase == myPhase)
+	    allHere->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SpinLock::SpinLock
+// 	Initialize a spin lock, so that it can be used for synchronization.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+SpinLock::SpinLock(char* debugName)
+{
+    name = debugName;
+    holder = NULL;
+}
+
+//----------------------------------------------------------------------
+// SpinLock::~SpinLock
+// 	De-allocate a spin lock.  Assume no one is holding it!
+//----------------------------------------------------------------------
+
+SpinLock::~SpinLock()
+{
+    ASSERT(holder == NULL);
+}
+
+//----------------------------------------------------------------------
+// SpinLock::Acquire
+// 	Wait until the lock is free, then take it.  Each time round the
+//	loop, we briefly disable interrupts and re-enable them, which 
+//	advances simulated time, and gives the other CPUs their turn --
+//	including the one holding the lock.
+//----------------------------------------------------------------------
 
-Condition::Condition(char* debugName) { }
-Condition::~Condition() { }
-void Condition::Wait(Lock* conditionLock) { ASSERT(FALSE); }
-void Condition::Signal(Lock* conditionLock) { }
-void Condition::Broadcast(Lock* conditionLock) { }
+void
+SpinLock::Acquire()
+{
+    ASSERT(interrupt->getLevel() == IntOn);	// or we'd spin forever
+    ASSERT(holder != currentThread);
+    while (holder != NULL) {
+	currentCpu->cpuStats->numSpins++;
+	interrupt->SetLevel(IntOff);
+	interrupt->SetLevel(IntOn);
+    }
+    holder = currentThread;
+}
+
+//----------------------------------------------------------------------
+// SpinLock::Release
+// 	Let go of the lock.  Anyone spinning on it sees it free the next
+//	time round.
+//----------------------------------------------------------------------
+
+void
+SpinLock::Release()
+{
+    ASSERT(holder == currentThread);
+    holder = NULL;
+}
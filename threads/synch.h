@@ -2,10 +2,7 @@
 //	Data structures for synchronizing threads.
 //
 //	Three kinds of synchronization are defined here: semaphores,
-//	locks, and condition variables.  The implementation for
-//	semaphores is given; for the latter two, only the procedure
-//	interface is given -- they are to be implemented as part of 
-//	the first assignment.
+//	locks, and condition variables.
 //
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
@@ -39,6 +36,9 @@
 class Semaphore {
   public:
     Semaphore(char* debugName, int initialValue);	// set initial value
+    Semaphore(char* debugName, int initialValue, ThreadActivity why);
+					// ... waiters wait for "why", eg,
+					// the disk (for accounting)
     ~Semaphore();   					// de-allocate semaphore
     char* getName() { return name;}			// debugging assist
     
@@ -49,6 +49,10 @@ class Semaphore {
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
     List *queue;       // threads waiting in P() for the value to be > 0
+    ThreadActivity waitingFor;	// what they are waiting for
+
+    void Setup(char* debugName, int initialValue, ThreadActivity why);
+				// Used by the constructors
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -62,6 +66,17 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// Release hands the lock directly to the waiter that should run first,
+// rather than setting it FREE and letting the waiters race for it; so 
+// a thread that goes to sleep in Acquire holds the lock when it wakes
+// up, and no one can barge in ahead of it.
+//
+// Locks also provide priority inheritance: while a thread waits for a
+// lock, the holder runs at the waiter's priority if that is higher 
+// (see Thread::EffectiveLevel), so that a low priority holder can't be
+// kept off the CPU, holding up the waiter indefinitely, by threads of
+// medium priority.  The donation passes along chains of waiting threads.
 
 class Lock {
   public:
@@ -77,9 +92,24 @@ class Lock {
 					// checking in Release, and in
 					// Condition variable ops below.
 
+    void AddWaiter(Thread *thread);	// Make "thread", which is asleep,
+					// wait for the lock as if it had
+					// called Acquire (for Condition)
+
   private:
     char* name;				// for debugging
-    // plus some other stuff you'll need to define
+    Thread *owner;			// the thread holding the lock; 
+					// NULL if it is FREE
+    List *queue;			// threads waiting in Acquire
+    Lock *nextHeld;			// the next lock "owner" holds
+
+    void GiveTo(Thread *thread);	// Make "thread" the owner
+    static void UpdateDonations(Thread *thread);
+					// Recompute the priority donated 
+					// to "thread" by its locks' waiters
+    static void Donate(Lock *lock);	// Update the donations along the
+					// chain of threads starting with 
+					// "lock"'s owner
 };
 
 // The following class defines a "condition variable".  A condition
@@ -100,7 +130,7 @@ class Lock {
 // In other words, mutual exclusion must be enforced among threads calling
 // the condition variable operations.
 //
-// In Nachos, condition variables are assumed to obey *Mesa*-style
+// In Nachos, condition variables obey *Mesa*-style
 // semantics.  When a Signal or Broadcast wakes up another thread,
 // it simply puts the thread on the ready list, and it is the responsibility
 // of the woken thread to re-acquire the lock (this re-acquire is
@@ -113,6 +143,12 @@ class Lock {
 // The consequence of using Mesa-style semantics is that some other thread
 // can acquire the lock, and change data structures, before the woken
 // thread gets a chance to run.
+//
+// Since the signaller holds the lock, there is no point in waking a 
+// thread up just to have it wait for the lock again.  Instead, Signal
+// moves the thread straight from the condition to the lock's queue, and
+// Release hands it the lock later.  Broadcast moves every waiter, so 
+// they get the lock one at a time, instead of all waking up at once.
 
 class Condition {
   public:
@@ -131,6 +167,94 @@ class Condition {
 
   private:
     char* name;
-    // plus some other stuff you'll need to define
+    List *queue;			// threads waiting in Wait()
+};
+
+// The following class defines a "readers/writers lock".  Any number of
+// readers may hold the lock at once, or else one writer:
+//
+//	ReadAcquire -- wait until no writer holds the lock, then hold it
+//		for reading
+//
+//	ReadRelease -- stop reading
+//
+//	WriteAcquire -- wait until no one holds the lock, then hold it
+//		for writing
+//
+//	WriteRelease -- stop writing
+//
+// Writers get preference: once a writer is waiting, new readers wait 
+// as well, so that a stream of readers can't keep writers out.  But 
+// when a writer is done, every reader waiting at that moment is let in,
+// as a batch, ahead of any other writers -- so that a stream of writers
+// can't keep readers out either.
+//
+// It is built out of a Lock and Conditions.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void ReadAcquire();			// these are the only operations
+    void ReadRelease();			// on a readers/writers lock
+    void WriteAcquire();
+    void WriteRelease();
+
+  private:
+    char* name;				// for debugging
+    Lock *lock;				// protects the fields below
+    Condition *readersOk;		// where readers wait
+    Condition *writersOk;		// where writers wait
+    int activeReaders;			// # of threads reading
+    bool activeWriter;			// is a thread writing?
+    int waitingReaders;			// # of readers waiting
+    int waitingWriters;			// # of writers waiting
+    int admitted;			// # of waiting readers let in by the
+					// last writer, but not yet reading
+};
+
+// The following class defines a "barrier".  A barrier is created for a
+// number of threads; each of them calls Wait(), and no one returns from
+// Wait() until all of them have called it.  The barrier can then be 
+// used again, for the next phase of the computation.
+
+class Barrier {
+  public:
+    Barrier(char* debugName, int numThreads);	// initialize barrier for 
+						// "numThreads" threads
+    ~Barrier();				// deallocate barrier
+    char* getName() { return name; }	// debugging assist
+
+    void Wait();			// wait for everyone to get here
+
+  private:
+    char* name;				// for debugging
+    Lock *lock;				// protects the fields below
+    Condition *allHere;			// where threads wait for the others
+    int count;				// # of threads using the barrier
+    int arrived;			// # that have called Wait this phase
+    int phase;				// # of times everyone has arrived
+};
+
+// The following class defines a "spin lock".  A thread that finds the
+// lock held doesn't sleep; it keeps trying, with interrupts enabled, 
+// until the thread holding it (on another CPU) lets go.  That wastes
+// the waiting CPU's time, so a spin lock is only for short critical 
+// sections, and the thread holding one must not block.
+
+class SpinLock {
+  public:
+    SpinLock(char* debugName);		// initialize lock to be FREE
+    ~SpinLock();			// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void Acquire();			// these are the only operations
+    void Release();			// on a spin lock
+
+  private:
+    char* name;				// for debugging
+    Thread *holder;			// the thread holding the lock, if any
 };
 #endif // SYNCH_H
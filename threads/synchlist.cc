@@ -59,6 +59,24 @@ SynchList::Append(void *item)
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchList::AppendLink
+//      Append an item to the end of the list, using the ListElement
+//	embedded in it.  Wake up anyone waiting for an element to be 
+//	appended.
+//
+//	"link" is the item's ListElement
+//----------------------------------------------------------------------
+
+void
+SynchList::AppendLink(ListElement *link)
+{
+    lock->Acquire();
+    list->AppendLink(link);
+    listEmpty->Signal(lock);
+    lock->Release();
+}
+
 //----------------------------------------------------------------------
 // SynchList::Remove
 //      Remove an "item" from the beginning of the list.  Wait if
@@ -28,6 +28,9 @@ class SynchList {
 
     void Append(void *item);	// append item to the end of the list,
 				// and wake up any thread waiting in remove
+    void AppendLink(ListElement *link);
+				// the same, for an item with its own
+				// ListElement (see list.h)
     void *Remove();		// remove the first item from the front of
 				// the list, waiting if the list is empty
 				// apply function to every item in the list
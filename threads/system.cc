@@ -13,11 +13,19 @@
 
 Thread *currentThread;			// the thread we are running now
 Thread *threadToBeDestroyed;  		// the thread that just finished
-Scheduler *scheduler;			// the ready list
+Scheduler *scheduler;			// the ready list of currentCpu
 Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+Alarm *alarmClock;			// for threads to sleep until a
+					// given time
+int stackSize = StackSize;		// size of thread stacks, in words
+bool guardStacks = FALSE;		// catch stack overflows with 
+					// unmapped guard pages?
+int numCpus = 1;			// # of CPUs we simulate
+Cpu **cpus;				// each of them
+Cpu *currentCpu;			// the CPU the host is running
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -25,12 +33,17 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+int maxReadAhead = MaxReadAhead;	// most sectors to read ahead of a file
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
 #endif
 
+#ifdef VM
+FrameTable *frameTable;	// what is in each page of physical memory
+#endif
+
 #ifdef NETWORK
 PostOffice *postOffice;
 #endif
@@ -60,7 +73,7 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if ((interrupt->getStatus() != IdleMode) && scheduler->TimerTick())
 	interrupt->YieldOnReturn();
 }
 
@@ -80,13 +93,30 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    SchedulerPolicy schedPolicy = FifoScheduling;
+    int mlfqLevels = MlfqLevels;
+    bool threadStats = FALSE;	// print statistics for each thread
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    bool decodeCache = FALSE;	// cache decoded user instructions
+    bool blockCache = FALSE;	// run user programs a basic block at a time
+#endif
+#ifdef VM
+    ReplacementType vmPolicy = FifoReplacement;
+#endif
+#ifdef USE_TLB
+    int tlbSize = TLBSize;	// # of TLB entries
+    int tlbWays = 0;		// TLB entries per set; 0 => fully associative
+    TLBReplacement tlbPolicy = TLBFifo;
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    int cacheSectors = CacheSectors;	// size of the buffer cache
+    DiskSchedPolicy diskPolicy = FifoDiskScheduling;
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
@@ -107,15 +137,80 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-sched")) {
+	    ASSERT(argc > 1);
+	    schedPolicy = SchedulerNamed(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-mlfqlevels")) {
+	    ASSERT(argc > 1);
+	    mlfqLevels = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ts"))
+	    threadStats = TRUE;
+	else if (!strcmp(*argv, "-stacksize")) {
+	    ASSERT(argc > 1);
+	    stackSize = atoi(*(argv + 1));
+	    ASSERT(stackSize >= MinStackSize);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-guardstacks"))
+	    guardStacks = TRUE;
+	else if (!strcmp(*argv, "-smp")) {
+	    ASSERT(argc > 1);
+	    numCpus = atoi(*(argv + 1));
+	    ASSERT((numCpus >= 1) && (numCpus <= MaxCpus));
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-decodecache"))
+	    decodeCache = TRUE;
+	else if (!strcmp(*argv, "-blocks"))
+	    blockCache = TRUE;
+#endif
+#ifdef VM
+	if (!strcmp(*argv, "-vmpolicy")) {
+	    ASSERT(argc > 1);
+	    vmPolicy = ReplacementNamed(*(argv + 1));
+	    argCount = 2;
+	}
+#endif
+#ifdef USE_TLB
+	if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    tlbSize = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbways")) {
+	    ASSERT(argc > 1);
+	    tlbWays = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbpolicy")) {
+	    ASSERT(argc > 1);
+	    tlbPolicy = TLBPolicyNamed(*(argv + 1));
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-cachesize")) {
+	    ASSERT(argc > 1);
+	    cacheSectors = atoi(*(argv + 1));
+	    ASSERT(cacheSectors >= 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-readahead")) {
+	    ASSERT(argc > 1);
+	    maxReadAhead = atoi(*(argv + 1));
+	    ASSERT(maxReadAhead >= 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-disksched")) {
+	    ASSERT(argc > 1);
+	    diskPolicy = DiskSchedulingNamed(*(argv + 1));
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -131,10 +226,17 @@ Initialize(int argc, char **argv)
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    stats->printThreads = threadStats;
     interrupt = new Interrupt;			// start up interrupt handling
-    scheduler = new Scheduler();		// initialize the ready queue
-    if (randomYield)				// start the timer (if needed)
+    ASSERT((numCpus == 1) || (schedPolicy == FifoScheduling));
+    cpus = new Cpu *[numCpus];			// initialize the CPUs, each
+    for (int i = 0; i < numCpus; i++)		// with its own ready queue
+	cpus[i] = new Cpu(i, schedPolicy, mlfqLevels);
+    currentCpu = cpus[0];
+    scheduler = currentCpu->scheduler;
+    if (randomYield || scheduler->NeedsTimer())	// start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    alarmClock = new Alarm;
 
     threadToBeDestroyed = NULL;
 
@@ -149,16 +251,28 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    if (decodeCache)
+	machine->EnableDecodeCache();
+    if (blockCache)
+	machine->EnableBlockCache();
+#ifdef USE_TLB
+    machine->ConfigureTLB(tlbSize, (tlbWays == 0) ? tlbSize : tlbWays, 
+				tlbPolicy);
+#endif
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", cacheSectors, diskPolicy);
 #endif
 
 #ifdef FILESYS_NEEDED
     fileSystem = new FileSystem(format);
 #endif
 
+#ifdef VM
+    frameTable = new FrameTable(vmPolicy);
+#endif
+
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
 #endif
@@ -176,6 +290,10 @@ Cleanup()
     delete postOffice;
 #endif
     
+#ifdef VM
+    delete frameTable;
+#endif
+
 #ifdef USER_PROGRAM
     delete machine;
 #endif
@@ -189,7 +307,10 @@ Cleanup()
 #endif
     
     delete timer;
-    delete scheduler;
+    delete alarmClock;
+    for (int i = 0; i < numCpus; i++)
+	delete cpus[i];
+    delete [] cpus;
     delete interrupt;
     
     Exit(0);
@@ -15,6 +15,8 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "alarm.h"
+#include "cpu.h"
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -24,10 +26,16 @@ extern void Cleanup();				// Cleanup, called when
 
 extern Thread *currentThread;			// the thread holding the CPU
 extern Thread *threadToBeDestroyed;  		// the thread that just finished
-extern Scheduler *scheduler;			// the ready list
+extern Scheduler *scheduler;			// the ready list (of currentCpu)
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern Alarm *alarmClock;			// to let threads sleep a while
+extern int stackSize;				// size of thread stacks, in words
+extern bool guardStacks;			// unmap the pages around them?
+extern int numCpus;				// # of CPUs we simulate
+extern Cpu **cpus;				// each of them
+extern Cpu *currentCpu;				// the CPU that has the host
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -39,9 +47,15 @@ extern Machine* machine;	// user program memory and registers
 extern FileSystem  *fileSystem;
 #endif
 
+#ifdef VM
+#include "frametable.h"
+extern FrameTable *frameTable;	// what is in each page of physical memory
+#endif
+
 #ifdef FILESYS
 #include "synchdisk.h"
 extern SynchDisk   *synchDisk;
+extern int maxReadAhead;	// most sectors to read ahead of a file
 #endif
 
 #ifdef NETWORK
@@ -31,25 +31,143 @@
 					// execution stack, for detecting 
 					// stack overflows
 
+// Stacks of finished threads, kept for new threads to use, so that 
+// creating a thread doesn't have to get memory from the host (and, with 
+// -guardstacks, map it and protect the guard pages).  A free stack is 
+// linked through its first word.
+
+#define MaxFreeStacks	64		// most stacks to keep
+
+static int *freeStacks = NULL;
+static int numFreeStacks = 0;
+
+//----------------------------------------------------------------------
+// NewStack
+// 	Return a stack of "stackSize" words: a free one if we have any,
+//	else a new one.
+//----------------------------------------------------------------------
+
+static int *
+NewStack()
+{
+    int *stack = freeStacks;
+
+    if (stack != NULL) {
+	freeStacks = *(int **) stack;
+	numFreeStacks--;
+	stats->numStackReuses++;
+	return stack;
+    }
+    stats->numStackAllocs++;
+    if (guardStacks)
+	return (int *) AllocGuardedArray(stackSize * sizeof(int));
+    return new int[stackSize];
+}
+
+//----------------------------------------------------------------------
+// FreeStack
+// 	Put "stack" on the free list, or if that is full, give it back.
+//----------------------------------------------------------------------
+
+static void
+FreeStack(int *stack)
+{
+    if (numFreeStacks < MaxFreeStacks) {
+	*(int **) stack = freeStacks;
+	freeStacks = stack;
+	numFreeStacks++;
+    } else if (guardStacks)
+	DeallocGuardedArray((char *) stack, stackSize * sizeof(int));
+    else
+	delete [] stack;
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	"numTickets" is the thread's share of the CPU, for stride and
+//		lottery scheduling; DefaultTickets if not given.
 //----------------------------------------------------------------------
 
 Thread::Thread(char* threadName)
+{
+    Setup(threadName, DefaultTickets);
+}
+
+Thread::Thread(char* threadName, int numTickets)
+{
+    Setup(threadName, numTickets);
+}
+
+//----------------------------------------------------------------------
+// Thread::Setup
+// 	The work of the constructors.
+//----------------------------------------------------------------------
+
+void
+Thread::Setup(char* threadName, int numTickets)
 {
     name = threadName;
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    queueLink.item = (void *) this;
+    schedLevel = 0;
+    schedEpoch = 0;
+    pass = 0;
+    cpu = (currentCpu != NULL) ? currentCpu->id : 0;
+    account = stats->NewThread(threadName);
+    blockedOn = BlockedOther;
+    setTickets(numTickets);
+    heldLocks = NULL;
+    waitingOn = NULL;
+    donatedLevel = MaxMlfqLevels;
+    donatedTickets = 0;
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
 }
 
+//----------------------------------------------------------------------
+// Thread::setTickets
+// 	Change the thread's share of the CPU.  With stride scheduling,
+//	it takes effect the next time the thread is charged for running;
+//	with lottery scheduling, at the next lottery.
+//
+//	"numTickets" must be between 1 and MaxTickets.
+//----------------------------------------------------------------------
+
+void
+Thread::setTickets(int numTickets)
+{
+    ASSERT((numTickets >= 1) && (numTickets <= MaxTickets));
+    tickets = numTickets;
+}
+
+//----------------------------------------------------------------------
+// Thread::EffectiveLevel, Thread::EffectiveTickets
+// 	Return the priority the scheduler should give the thread: its
+//	own, or if it holds locks that higher priority threads are 
+//	waiting for, theirs (see Lock::Acquire).  For MLFQ, that is the
+//	better of the levels; for stride and lottery scheduling, the
+//	waiters lend the holder their tickets.
+//----------------------------------------------------------------------
+
+int
+Thread::EffectiveLevel()
+{
+    return min(schedLevel, donatedLevel);
+}
+
+int
+Thread::EffectiveTickets()
+{
+    return min(tickets + donatedTickets, MaxTickets);
+}
+
 //----------------------------------------------------------------------
 // Thread::~Thread
 // 	De-allocate a thread.
@@ -67,8 +185,40 @@ Thread::~Thread()
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
     ASSERT(this != currentThread);
+    if (stats->printThreads)
+	account->Charge(Finished);	// kept, to be printed at the end
+    else
+	delete account;
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	FreeStack(stack);
+}
+
+//----------------------------------------------------------------------
+// Thread::setStatus
+// 	Change the thread's status, charging the time since its last
+//	change to what it was doing (see ThreadStatistics).
+//
+//	"st" is the new status.
+//----------------------------------------------------------------------
+
+void
+Thread::setStatus(ThreadStatus st)
+{
+    status = st;
+    switch (st) {
+      case RUNNING:
+	account->Charge(Running);
+	break;
+      case READY:
+	account->Charge(Ready);
+	break;
+      case BLOCKED:
+	account->Charge(blockedOn);
+	break;
+      default:
+	account->Charge(NotStarted);
+	break;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -125,7 +275,7 @@ Thread::CheckOverflow()
 {
     if (stack != NULL)
 #ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
-	ASSERT(stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT(stack[stackSize - 1] == STACK_FENCEPOST);
 #else
 	ASSERT((int) *stack == (int) STACK_FENCEPOST);
 #endif
@@ -214,20 +364,41 @@ Thread::Yield ()
 //	disable interrupts for atomicity.   We need interrupts off 
 //	so that there can't be a time slice between pulling the first thread
 //	off the ready list, and switching to it.
+//
+//	With more than one CPU, the CPU only idles if every other CPU is
+//	idle as well; otherwise, the host switches to another CPU, and 
+//	this one idles until it is given something to run.
+//
+//	"why" says what we are waiting for, so that the time we spend 
+//	blocked can be accounted for; without it, we are waiting for
+//	nothing in particular.
 //----------------------------------------------------------------------
 void
 Thread::Sleep ()
+{
+    Sleep(BlockedOther);
+}
+
+void
+Thread::Sleep (ThreadActivity why)
 {
     Thread *nextThread;
+    Cpu *other;
     
     ASSERT(this == currentThread);
     ASSERT(interrupt->getLevel() == IntOff);
     
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
-    status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
+    blockedOn = why;
+    setStatus(BLOCKED);
+    while ((nextThread = scheduler->FindNextToRun()) == NULL) {
+	if ((numCpus > 1) && ((other = NextCpu()) != NULL)) {
+	    nextThread = EnterCpu(other);	// let another CPU run
+	    break;
+	}
 	interrupt->Idle();	// no one to run, wait for an interrupt
+    }
         
     scheduler->Run(nextThread); // returns when we've been signalled
 }
@@ -259,19 +430,19 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = NewStack();
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[stackSize - 1] = STACK_FENCEPOST;
 #else
     // i386 & MIPS & SPARC stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
-    stackTop = stack + StackSize - 96;
+    stackTop = stack + stackSize - 96;
 #else  // HOST_MIPS  || HOST_i386
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
@@ -24,7 +24,9 @@
 //	that your thread stacks are too small.)
 //	
 //	One thing to try if you find yourself with seg faults is to
-//	increase the size of thread stack -- ThreadStackSize.
+//	increase the size of thread stack -- StackSize, or -stacksize.
+//	Another is -guardstacks, which unmaps the pages on either side of
+//	each stack, so that running off the end faults right away.
 //
 //  	In this interface, forking a thread takes two steps.
 //	We must first allocate a data structure for it: "t = new Thread".
@@ -39,6 +41,8 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
+#include "stats.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -51,17 +55,25 @@
 #define MachineStateSize 18 
 
 
-// Size of the thread's private execution stack.
+// Size of the thread's private execution stack, unless set with 
+// -stacksize (see "stackSize" in system.h).
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
+#define MinStackSize	1024		// smallest allowed with -stacksize
 
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
+// Shares of the CPU, for proportional-share scheduling
+#define DefaultTickets	100
+#define MaxTickets	10000
+
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(int arg);	 
 
+class Lock;
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -82,6 +94,8 @@ class Thread {
 
   public:
     Thread(char* debugName);		// initialize a Thread 
+    Thread(char* debugName, int numTickets);
+					// ... with this share of the CPU
     ~Thread(); 				// deallocate a Thread
 					// NOTE -- thread being deleted
 					// must not be running when delete 
@@ -94,14 +108,41 @@ class Thread {
 						// other thread is runnable
     void Sleep();  				// Put the thread to sleep and 
 						// relinquish the processor
+    void Sleep(ThreadActivity why);		// ... saying what we wait for
     void Finish();  				// The thread is done executing
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
-    void setStatus(ThreadStatus st) { status = st; }
+    void setStatus(ThreadStatus st);	// Change status, and account
+					// for the time spent in the old one
+    ThreadStatus getStatus() { return status; }
+    void setTickets(int numTickets);	// Change the thread's share of the
+    int getTickets() { return tickets; }	// CPU, for stride and 
+					// lottery scheduling
+    int EffectiveLevel();		// MLFQ level and tickets to schedule
+    int EffectiveTickets();		// by, counting what is donated by 
+					// threads waiting for our locks
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
 
+    ListElement queueLink;		// to put the thread on the ready list,
+					// or a semaphore's queue, without 
+					// allocating anything; it is only
+					// on one of them at a time
+    int schedLevel;			// MLFQ priority level; 0 is highest
+    int schedEpoch;			// MLFQ boosts it has been through
+    unsigned int pass;			// stride scheduling: virtual time
+    int cpu;				// the CPU we last ran on, whose 
+					// ready list we go back on
+    ThreadStatistics *account;		// where our time goes
+
+    Lock *heldLocks;			// locks we hold, linked through them
+    Lock *waitingOn;			// the lock we are waiting for, if any
+    int donatedLevel;			// priority inheritance: the best MLFQ
+					// level of the threads waiting for
+					// our locks (MaxMlfqLevels if none)
+    int donatedTickets;			// ... and the sum of their tickets
+
   private:
     // some of the private data for this class is listed above
     
@@ -109,7 +150,12 @@ class Thread {
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
+    ThreadActivity blockedOn;		// what we are waiting for, if blocked
     char* name;
+    int tickets;			// share of the CPU
+
+    void Setup(char* threadName, int numTickets);
+					// Used by the constructors
 
     void StackAllocate(VoidFunctionPtr func, void *arg);
     					// Allocate a stack for thread.
@@ -11,6 +11,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "synch.h"
 #include "elevatortest.h"
 
 // testnum is set in main.cc
@@ -53,6 +54,480 @@ ThreadTest1()
     SimpleThread(0);
 }
 
+// Parameters of the interrupt queue benchmark
+#define BenchEvents	1000000		// interrupts to schedule in all
+#define BenchPending	1000		// interrupts pending at any one time
+#define BenchSpread	1000		// how far ahead each is scheduled
+
+static int benchScheduled;		// interrupts scheduled so far
+static int benchFired;			// ... and handled
+
+//----------------------------------------------------------------------
+// BenchInterrupt
+// 	Interrupt handler for the interrupt queue benchmark: schedule 
+//	another interrupt in place of this one, until we have done enough.
+//----------------------------------------------------------------------
+
+static void
+BenchInterrupt(int dummy)
+{
+    benchFired++;
+    if (benchScheduled < BenchEvents) {
+	benchScheduled++;
+	interrupt->Schedule(BenchInterrupt, 0, 1 + Random() % BenchSpread,
+				TimerInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// InterruptQueueTest
+// 	Benchmark the queue of pending interrupts, by keeping BenchPending
+//	interrupts at random times pending, and advancing the clock until
+//	BenchEvents of them have fired.  Report the real time each
+//	Schedule/fire cycle takes on the host.
+//----------------------------------------------------------------------
+
+void
+InterruptQueueTest()
+{
+    double start = HostTime();
+
+    benchScheduled = benchFired = 0;
+    for (int i = 0; i < BenchPending; i++) {
+	benchScheduled++;
+	interrupt->Schedule(BenchInterrupt, 0, 1 + Random() % BenchSpread,
+				TimerInt);
+    }
+    while (benchFired < benchScheduled) {
+	interrupt->SetLevel(IntOff);	// re-enabling interrupts advances
+	interrupt->SetLevel(IntOn);	// the clock, and fires any due
+    }
+    printf("Interrupt queue: %d interrupts, %d ticks, %d ns per "
+		"Schedule/fire\n", benchFired, stats->totalTicks,
+		(int) ((HostTime() - start) * 1e9 / benchFired));
+}
+
+// Parameters of the fairness benchmark
+#define FairThreads	4		// # of threads competing for the CPU
+#define FairDuration	1000000		// how long they compete, in ticks
+
+static int fairTicks[FairThreads];	// CPU time each thread has had
+static Semaphore *fairDone;		// signalled as each thread finishes
+
+//----------------------------------------------------------------------
+// FairThread
+// 	Compute until simulated time reaches FairDuration, counting the
+//	ticks that we get.  Each pass around the loop uses one SystemTick
+//	of our own time; if we lose the CPU, it is after that tick.
+//
+//	"which" identifies the thread
+//----------------------------------------------------------------------
+
+static void
+FairThread(int which)
+{
+    while (stats->totalTicks < FairDuration) {
+	interrupt->SetLevel(IntOff);	// re-enabling interrupts advances
+	interrupt->SetLevel(IntOn);	// the clock
+	fairTicks[which] += SystemTick;
+    }
+    fairDone->V();
+}
+
+//----------------------------------------------------------------------
+// FairnessTest
+// 	Benchmark the proportional-share schedulers: run FairThreads
+//	CPU-bound threads, holding 1, 2, 3, ... shares of the CPU, and
+//	report the share of the time each one got compared to its target.
+//	Run it with -sched stride or -sched lottery.
+//----------------------------------------------------------------------
+
+void
+FairnessTest()
+{
+    int tickets, totalTickets = 0, totalTicks = 0;
+    Thread *t;
+    int i;
+
+    fairDone = new Semaphore("fairness", 0);
+    for (i = 0; i < FairThreads; i++) {
+	fairTicks[i] = 0;
+	tickets = (i + 1) * DefaultTickets;
+	totalTickets += tickets;
+	t = new Thread("fair", tickets);
+	t->Fork(FairThread, (void *) i);
+    }
+    for (i = 0; i < FairThreads; i++)	// wait for them all; we don't
+	fairDone->P();			// compete for the CPU meanwhile
+    for (i = 0; i < FairThreads; i++)
+	totalTicks += fairTicks[i];
+    for (i = 0; i < FairThreads; i++)
+	printf("Thread %d: %d tickets, %d ticks, %d.%d%% of the CPU "
+		"(target %d.%d%%)\n", i, (i + 1) * DefaultTickets, 
+		fairTicks[i], fairTicks[i] * 100 / totalTicks, 
+		(fairTicks[i] * 1000 / totalTicks) % 10, 
+		(i + 1) * DefaultTickets * 100 / totalTickets,
+		((i + 1) * DefaultTickets * 1000 / totalTickets) % 10);
+    delete fairDone;
+}
+
+// Parameters of the lock contention benchmark
+#define LockThreads	4		// # of threads competing for the lock
+#define LockRounds	1000		// times each one acquires it
+#define LockHold	5		// SystemTicks spent holding it
+
+static Lock *benchLock;			// the lock they compete for
+static Condition *lockDone;		// signalled as each thread finishes
+static int lockFinished;		// # of threads finished
+static int lockWaitTicks;		// total time spent in Acquire
+
+//----------------------------------------------------------------------
+// LockThread
+// 	Acquire and release "benchLock" LockRounds times, timing how long
+//	each Acquire takes.  We yield while holding the lock, so that the 
+//	other threads run into it.
+//
+//	"which" identifies the thread
+//----------------------------------------------------------------------
+
+static void
+LockThread(int which)
+{
+    int start;
+
+    for (int i = 0; i < LockRounds; i++) {
+	start = stats->totalTicks;
+	benchLock->Acquire();
+	lockWaitTicks += stats->totalTicks - start;
+	for (int j = 0; j < LockHold; j++) {
+	    interrupt->SetLevel(IntOff);	// advance the clock
+	    interrupt->SetLevel(IntOn);
+	}
+	currentThread->Yield();
+	benchLock->Release();
+    }
+    benchLock->Acquire();
+    lockFinished++;
+    lockDone->Signal(benchLock);
+    benchLock->Release();
+}
+
+//----------------------------------------------------------------------
+// LockTest
+// 	Benchmark locks: run LockThreads threads that all want the same
+//	lock, and report the context switches and the time spent waiting
+//	for each acquisition.
+//----------------------------------------------------------------------
+
+void
+LockTest()
+{
+    int switches = stats->numContextSwitches;
+    int acquires = LockThreads * LockRounds;
+    Thread *t;
+
+    benchLock = new Lock("benchmark");
+    lockDone = new Condition("benchmark done");
+    lockFinished = lockWaitTicks = 0;
+    for (int i = 0; i < LockThreads; i++) {
+	t = new Thread("locker");
+	t->Fork(LockThread, (void *) i);
+    }
+    benchLock->Acquire();
+    while (lockFinished < LockThreads)
+	lockDone->Wait(benchLock);
+    benchLock->Release();
+
+    switches = stats->numContextSwitches - switches;
+    printf("Lock contention: %d acquisitions, %d context switches, "
+	    "%d ticks waiting\n", acquires, switches, lockWaitTicks);
+    printf("Per acquisition: %d.%02d context switches, %d ticks waiting\n",
+	    switches / acquires, (switches * 100 / acquires) % 100,
+	    lockWaitTicks / acquires);
+    delete lockDone;
+    delete benchLock;
+}
+
+// Parameters of the thread creation benchmark
+#define ChurnThreads	10000		// threads to create and finish
+
+//----------------------------------------------------------------------
+// ChurnThread
+// 	A thread that does nothing but finish.
+//----------------------------------------------------------------------
+
+static void
+ChurnThread(int dummy)
+{
+}
+
+//----------------------------------------------------------------------
+// ChurnTest
+// 	Benchmark thread creation: fork ChurnThreads short-lived threads,
+//	one at a time, letting each finish before forking the next, and
+//	report the real time each Fork/Finish cycle takes on the host.
+//	Try it with and without -guardstacks.
+//----------------------------------------------------------------------
+
+void
+ChurnTest()
+{
+    double start = HostTime();
+    Thread *t;
+
+    for (int i = 0; i < ChurnThreads; i++) {
+	t = new Thread("churn");
+	t->Fork(ChurnThread, (void *) i);
+	currentThread->Yield();		// let it run, and finish
+    }
+    printf("Thread churn: %d threads, %d ns per Fork/Finish\n", 
+	    ChurnThreads, (int) ((HostTime() - start) * 1e9 / ChurnThreads));
+}
+
+// Parameters of the alarm test
+#define AlarmThreads	5		// # of threads sleeping
+#define AlarmRounds	10		// times each one sleeps
+#define AlarmPeriod	1000		// thread i sleeps (i + 1) * this
+
+static int alarmLate[AlarmThreads];	// how late each thread woke, in all
+static Semaphore *alarmDone;		// signalled as each thread finishes
+
+//----------------------------------------------------------------------
+// AlarmThread
+// 	Sleep AlarmRounds times, like a daemon that wakes up periodically,
+//	adding up how late we wake up.
+//
+//	"which" identifies the thread
+//----------------------------------------------------------------------
+
+static void
+AlarmThread(int which)
+{
+    int howLong = (which + 1) * AlarmPeriod;
+    int due;
+
+    for (int i = 0; i < AlarmRounds; i++) {
+	due = stats->totalTicks + howLong;
+	alarmClock->WaitUntil(howLong);
+	ASSERT(stats->totalTicks >= due);
+	alarmLate[which] += stats->totalTicks - due;
+    }
+    alarmDone->V();
+}
+
+//----------------------------------------------------------------------
+// AlarmTest
+// 	Run AlarmThreads threads that sleep for different periods, and 
+//	report how late they woke up, and how much of the time the CPU
+//	was idle -- nearly all of it, since no one busy-waits.
+//----------------------------------------------------------------------
+
+void
+AlarmTest()
+{
+    int start = stats->totalTicks, idle = stats->idleTicks;
+    Thread *t;
+    int i;
+
+    alarmDone = new Semaphore("alarm test", 0);
+    for (i = 0; i < AlarmThreads; i++) {
+	alarmLate[i] = 0;
+	t = new Thread("sleeper");
+	t->Fork(AlarmThread, (void *) i);
+    }
+    for (i = 0; i < AlarmThreads; i++)
+	alarmDone->P();
+    for (i = 0; i < AlarmThreads; i++)
+	printf("Thread %d: slept %d ticks %d times, %d ticks late on "
+		"average\n", i, (i + 1) * AlarmPeriod, AlarmRounds, 
+		alarmLate[i] / AlarmRounds);
+    printf("Alarm test: %d ticks, %d of them idle\n", 
+	    stats->totalTicks - start, stats->idleTicks - idle);
+    delete alarmDone;
+}
+
+// Parameters of the readers/writers lock benchmark
+#define RWReaders	4		// # of reader threads
+#define RWRounds	50		// times each one reads
+#define RWWrites	10		// times the writer thread writes
+#define RWReadTime	100		// how long each read or write takes,
+					// eg, waiting for the disk
+
+static bool rwShared;			// use "rwLock"? else "rwMutex"
+static RWLock *rwLock;			// lets readers in together
+static Lock *rwMutex;			// lets in one thread at a time
+static Barrier *rwStart;		// so that everyone starts together
+static Semaphore *rwDone;		// signalled as each thread finishes
+
+//----------------------------------------------------------------------
+// RWReader, RWWriter
+// 	Read (write) RWRounds (RWWrites) times, holding the lock while we
+//	wait RWReadTime ticks.
+//----------------------------------------------------------------------
+
+static void
+RWReader(int which)
+{
+    rwStart->Wait();
+    for (int i = 0; i < RWRounds; i++) {
+	if (rwShared)
+	    rwLock->ReadAcquire();
+	else
+	    rwMutex->Acquire();
+	alarmClock->WaitUntil(RWReadTime);
+	if (rwShared)
+	    rwLock->ReadRelease();
+	else
+	    rwMutex->Release();
+    }
+    rwDone->V();
+}
+
+static void
+RWWriter(int which)
+{
+    rwStart->Wait();
+    for (int i = 0; i < RWWrites; i++) {
+	if (rwShared)
+	    rwLock->WriteAcquire();
+	else
+	    rwMutex->Acquire();
+	alarmClock->WaitUntil(RWReadTime);
+	if (rwShared)
+	    rwLock->WriteRelease();
+	else
+	    rwMutex->Release();
+	alarmClock->WaitUntil(RWReadTime * RWRounds / RWWrites);
+    }
+    rwDone->V();
+}
+
+//----------------------------------------------------------------------
+// RWRun
+// 	Run RWReaders readers and a writer, and report how many reads
+//	they got done per 1000 ticks.  "shared" says whether to use the
+//	readers/writers lock, or a plain lock.
+//----------------------------------------------------------------------
+
+static void
+RWRun(bool shared)
+{
+    int start, elapsed;
+    Thread *t;
+
+    rwShared = shared;
+    rwStart = new Barrier("rw start", RWReaders + 1);
+    rwDone = new Semaphore("rw done", 0);
+    for (int i = 0; i < RWReaders; i++) {
+	t = new Thread("reader");
+	t->Fork(RWReader, (void *) i);
+    }
+    t = new Thread("writer");
+    t->Fork(RWWriter, (void *) 0);
+
+    start = stats->totalTicks;
+    for (int i = 0; i < RWReaders + 1; i++)
+	rwDone->P();
+    elapsed = stats->totalTicks - start;
+    printf("%s: %d reads, %d writes in %d ticks, %d reads per 1000 "
+	    "ticks\n", shared ? "Readers/writers lock" : "Mutual exclusion",
+	    RWReaders * RWRounds, RWWrites, elapsed, 
+	    RWReaders * RWRounds * 1000 / elapsed);
+    delete rwDone;
+    delete rwStart;
+}
+
+//----------------------------------------------------------------------
+// RWLockTest
+// 	Benchmark readers/writers locks against plain locks, for a 
+//	read-mostly workload.
+//----------------------------------------------------------------------
+
+void
+RWLockTest()
+{
+    rwLock = new RWLock("rw lock");
+    rwMutex = new Lock("rw mutex");
+    RWRun(FALSE);
+    RWRun(TRUE);
+    delete rwMutex;
+    delete rwLock;
+}
+
+// Parameters of the multiprocessor benchmark
+#define SmpThreads	8		// # of CPU-bound threads
+#define SmpRounds	2000		// SystemTicks of work each one does
+#define SmpShareEvery	50		// how often it updates "smpShared"
+#define SmpHold		3		// SystemTicks spent holding "smpLock"
+
+static SpinLock *smpLock;		// protects "smpShared"
+static int smpShared;			// work done, by everyone
+static Semaphore *smpDone;		// signalled as each thread finishes
+
+//----------------------------------------------------------------------
+// SmpThread
+// 	Compute for SmpRounds SystemTicks, now and then adding the work 
+//	we have done to the total, under a spin lock.
+//----------------------------------------------------------------------
+
+static void
+SmpThread(int which)
+{
+    int done = 0;
+
+    for (int i = 0; i < SmpRounds; i++) {
+	interrupt->SetLevel(IntOff);	// re-enabling interrupts advances
+	interrupt->SetLevel(IntOn);	// the clock
+	if (++done == SmpShareEvery) {
+	    smpLock->Acquire();
+	    for (int j = 0; j < SmpHold; j++) {
+		interrupt->SetLevel(IntOff);
+		interrupt->SetLevel(IntOn);
+	    }
+	    smpShared += done;
+	    smpLock->Release();
+	    done = 0;
+	}
+    }
+    smpLock->Acquire();
+    smpShared += done;
+    smpLock->Release();
+    smpDone->V();
+}
+
+//----------------------------------------------------------------------
+// SmpTest
+// 	Benchmark the multiprocessor: run SmpThreads CPU-bound threads,
+//	and report how much work they got done per 1000 ticks.  Run it
+//	with -smp 1, 2, 4, ...; the spin lock keeps it from scaling 
+//	perfectly.
+//----------------------------------------------------------------------
+
+void
+SmpTest()
+{
+    int start, elapsed;
+    Thread *t;
+
+    smpLock = new SpinLock("smp lock");
+    smpShared = 0;
+    smpDone = new Semaphore("smp done", 0);
+    start = stats->totalTicks;
+    for (int i = 0; i < SmpThreads; i++) {
+	t = new Thread("smp");
+	t->Fork(SmpThread, (void *) i);
+    }
+    for (int i = 0; i < SmpThreads; i++)
+	smpDone->P();
+    elapsed = stats->totalTicks - start;
+    ASSERT(smpShared == SmpThreads * SmpRounds);
+    printf("SMP: %d CPUs, %d threads, %d ticks, %d rounds per 1000 "
+	    "ticks\n", numCpus, SmpThreads, elapsed, 
+	    smpShared * 1000 / elapsed);
+    delete smpDone;
+    delete smpLock;
+}
+
 //----------------------------------------------------------------------
 // ThreadTest
 // 	Invoke a test routine.
@@ -65,6 +540,27 @@ ThreadTest()
     case 1:
 	ThreadTest1();
 	break;
+    case 2:
+	InterruptQueueTest();
+	break;
+    case 3:
+	FairnessTest();
+	break;
+    case 4:
+	LockTest();
+	break;
+    case 5:
+	ChurnTest();
+	break;
+    case 6:
+	AlarmTest();
+	break;
+    case 7:
+	RWLockTest();
+	break;
+    case 8:
+	SmpTest();
+	break;
     default:
 	printf("No test specified.\n");
 	break;
@@ -18,7 +18,9 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
+#ifdef VM
+#include "frametable.h"
+#endif
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
@@ -45,6 +47,29 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// FromExecutable
+// 	Return TRUE if any part of virtual page "vpn" comes from the
+//	object file, ie, the code or initialized data segment.  Other
+//	pages (the uninitialized data and the stack) start out as zeroes,
+//	so we don't need to touch them until the program does.
+//----------------------------------------------------------------------
+
+static bool
+FromExecutable(NoffHeader *noffH, int vpn)
+{
+    int pageStart = vpn * PageSize;
+    Segment *segs[2];
+
+    segs[0] = &noffH->code;
+    segs[1] = &noffH->initData;
+    for (int i = 0; i < 2; i++)
+	if ((segs[i]->size > 0) && (segs[i]->virtualAddr < pageStart + PageSize)
+		&& (segs[i]->virtualAddr + segs[i]->size > pageStart))
+	    return TRUE;
+    return FALSE;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -57,6 +82,15 @@ SwapHeader (NoffHeader *noffH)
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uniprogramming, and we have a single unsegmented page table
 //
+//	Pages of uninitialized data and stack are left invalid, and are
+//	zeroed by HandlePageFault the first time they are touched.
+//
+//	With virtual memory, nothing is loaded yet: every page starts out
+//	invalid, and is brought in by HandlePageFault the first time it
+//	is touched.  So the program can be bigger than physical memory.
+//	Pages that hold only code are read-only, so that every address 
+//	space running the same program can share them.
+//
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
@@ -78,10 +112,12 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
+#ifndef VM
     ASSERT(numPages <= NumPhysPages);		// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
+#endif
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
@@ -89,18 +125,39 @@ AddrSpace::AddrSpace(OpenFile *executable)
     pageTable = new TranslationEntry[numPages];
     for (i = 0; i < numPages; i++) {
 	pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
+#ifdef VM
+	pageTable[i].physicalPage = -1;
+	pageTable[i].valid = FALSE;	// not in memory until referenced
+#else
 	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
+	pageTable[i].valid = FromExecutable(&noffH, i);	// else zero-fill
+#endif
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
 	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
 					// a separate page, we could set its 
 					// pages to be read-only
     }
-    
-// zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
-    bzero(machine->mainMemory, size);
+
+#ifdef VM
+    execFile = executable;
+    execRefs = new int;
+    *execRefs = 1;
+    noffHeader = noffH;
+    textFile = executable->FileId();
+    backingStore = new BackingStore(numPages);
+    cow = new bool[numPages];
+    for (i = 0; i < numPages; i++) {
+	cow[i] = FALSE;
+	pageTable[i].readOnly = IsText(i);	// code pages can be shared
+    }
+#else
+// zero out the pages holding the code and data segments, since the
+// segments may not fill them; the rest of the address space is zeroed
+// on demand
+    for (i = 0; i < numPages; i++)
+	if (pageTable[i].valid)
+	    bzero(&(machine->mainMemory[i * PageSize]), PageSize);
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0) {
@@ -115,16 +172,84 @@ AddrSpace::AddrSpace(OpenFile *executable)
         executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]),
 			noffH.initData.size, noffH.initData.inFileAddr);
     }
+    machine->FlushDecodeCache();	// we just replaced the program text
+#endif
+}
 
+#ifdef VM
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create a copy of the address space "parent", for the Fork system
+//	call.  Rather than copying every page, the child shares each page
+//	the parent has in memory, and both map it read-only; the first
+//	one to write to the page gets its own copy (see HandleReadOnly).
+//	Pages the parent has evicted are copied from its backing store;
+//	pages it has never touched will be loaded from the executable,
+//	which the two address spaces also share.
+//
+//	A shared page the parent has saved before may not be dirty, but
+//	the child has no copy of its own, so the child must save it if
+//	the page is evicted.
+//
+//	"parent" -- the address space to copy; it must be running, so
+//		that we can get its latest use and dirty bits from the TLB
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace *parent)
+{
+    TranslationEntry *from;
+    unsigned int i;
+
+    numPages = parent->numPages;
+    execFile = parent->execFile;
+    execRefs = parent->execRefs;
+    (*execRefs)++;
+    noffHeader = parent->noffHeader;
+    textFile = parent->textFile;
+    backingStore = new BackingStore(numPages);
+    pageTable = new TranslationEntry[numPages];
+    cow = new bool[numPages];
+
+    DEBUG('v', "Forking address space, num pages %d\n", numPages);
+    frameTable->Acquire();		// no pages may move while we copy
+    parent->SyncTLB();
+    for (i = 0; i < numPages; i++) {
+	from = &parent->pageTable[i];
+	pageTable[i] = *from;
+	cow[i] = FALSE;
+	if (from->valid) {
+	    if (!from->readOnly || parent->cow[i]) {
+		from->readOnly = pageTable[i].readOnly = TRUE;
+		parent->cow[i] = cow[i] = TRUE;
+	    }
+	    pageTable[i].dirty = from->dirty || parent->backingStore->Holds(i);
+	    frameTable->Share(from->physicalPage, this, i);
+	} else if (parent->backingStore->Holds(i))
+	    backingStore->CopyPage(parent->backingStore, i);
+    }
+    parent->RestoreState();		// drop its writable translations
+    frameTable->Release();
 }
+#endif
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space.  With virtual memory, give back its
+//	page frames, and throw away its backing store.  The executable
+//	is closed once no forked copy of the address space is using it.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+#ifdef VM
+   frameTable->FreeFrames(this);
+   delete backingStore;
+   if (--(*execRefs) == 0) {
+	delete execFile;
+	delete execRefs;
+   }
+   delete [] cow;
+#endif
    delete pageTable;
 }
 
@@ -165,22 +290,363 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	If there is a TLB, the hardware has been setting the use and 
+//	dirty bits there, rather than in our page table; copy them back.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
-{}
+{
+    SyncTLB();
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      Tell the machine where to find the page table; or, if there is
+//	a TLB, empty it, so that it will be refilled from our page table
+//	as the program runs.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
-    machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
+    if (machine->tlb == NULL) {
+	machine->pageTable = pageTable;
+	machine->pageTableSize = numPages;
+    } else
+	for (int i = 0; i < machine->tlbSize; i++)
+	    machine->tlb[i].valid = FALSE;
+    machine->FlushTranslationCache();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TLBRefill
+// 	Handle a TLB miss: load the translation for "badVAddr" from our
+//	page table into the TLB, replacing another entry if need be.
+//	The faulting instruction is then re-executed.
+//
+//	Returns FALSE if the address isn't part of this address space,
+//	or the page isn't in memory, so this is a real page fault.
+//
+//	"badVAddr" -- the virtual address that missed in the TLB
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::TLBRefill(int badVAddr)
+{
+    unsigned int vpn = (unsigned) badVAddr / PageSize;
+    TranslationEntry *entry;
+    int slot;
+
+    if ((vpn >= numPages) || !pageTable[vpn].valid)
+	return FALSE;
+    slot = machine->TLBSlotFor(vpn);
+    entry = &machine->tlb[slot];
+    if (entry->valid)
+	SyncTLBEntry(entry);		// we're about to lose its bits
+    DEBUG('a', "TLB miss at 0x%x, loading page %d into entry %d\n", 
+		badVAddr, vpn, slot);
+    *entry = pageTable[vpn];
+    machine->TLBLoaded(slot);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SyncTLB
+// 	Copy the use and dirty bits set by the hardware in the TLB back
+//	to our page table, eg, before a context switch, or before the 
+//	page replacement policy looks at them.  Only the running address
+//	space has anything in the TLB.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SyncTLB()
+{
+    if (machine->tlb != NULL)
+	for (int i = 0; i < machine->tlbSize; i++)
+	    if (machine->tlb[i].valid)
+		SyncTLBEntry(&machine->tlb[i]);
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::SyncTLBEntry
+// 	Copy the use and dirty bits set by the hardware in a TLB entry
+//	back to our page table.  The use bit is moved rather than copied,
+//	so that if the replacement policy clears it in the page table,
+//	it stays clear until the page is used again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SyncTLBEntry(TranslationEntry *entry)
+{
+    TranslationEntry *pte = &pageTable[entry->virtualPage];
+
+    if (entry->use)
+	pte->use = TRUE;
+    if (entry->dirty)
+	pte->dirty = TRUE;
+    entry->use = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+// 	Bring the page containing "badVAddr" into memory, because the
+//	user program referenced it.  If there is a TLB, the faulting 
+//	instruction will miss again, and TLBRefill will load it.
+//
+//	Without virtual memory, every page is already in memory, but
+//	pages of uninitialized data and stack haven't been zeroed yet.
+//
+//	Returns FALSE if "badVAddr" is outside the address space.
+//
+//	"badVAddr" -- the virtual address that caused the page fault
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandlePageFault(int badVAddr)
+{
+    unsigned int vpn = (unsigned) badVAddr / PageSize;
+
+    if (vpn >= numPages)
+	return FALSE;
+#ifdef VM
+    stats->numPageFaults++;
+    frameTable->PageIn(this, vpn, IsText(vpn) ? textFile : -1);
+#else
+    if (pageTable[vpn].valid)
+	return FALSE;			// a real fault, not a zero-fill
+    stats->numPageFaults++;
+    DEBUG('a', "Zero-filling page %d\n", vpn);
+    stats->numZeroFillFaults++;
+    bzero(&(machine->mainMemory[pageTable[vpn].physicalPage * PageSize]), 
+		PageSize);
+    machine->InvalidateDecodePage(pageTable[vpn].physicalPage);
+    pageTable[vpn].valid = TRUE;
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadByte
+// 	Read the byte at "virtAddr" in this address space, on behalf of
+//	a system call.  The kernel translates the address itself, through
+//	our page table, rather than having the machine raise exceptions
+//	at it; if the page isn't in memory, we bring it in, just as for a
+//	page fault from user code.
+//
+//	Returns FALSE if "virtAddr" isn't part of the address space.
+//
+//	"virtAddr" -- the user virtual address to read
+//	"value" -- where to put the byte
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ReadByte(int virtAddr, char *value)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    unsigned int offset = (unsigned) virtAddr % PageSize;
+
+    if (vpn >= numPages)
+	return FALSE;
+    while (!pageTable[vpn].valid)	// another thread may run, and evict
+	if (!HandlePageFault(virtAddr))	// it again, before we get back
+	    return FALSE;
+    pageTable[vpn].use = TRUE;
+    *value = machine->mainMemory[pageTable[vpn].physicalPage * PageSize 
+					+ offset];
+    return TRUE;
+}
+
+#ifdef VM
+//----------------------------------------------------------------------
+// AddrSpace::IsText
+// 	Return TRUE if virtual page "vpn" holds only code, and none of
+//	the initialized or uninitialized data, so that it never changes
+//	and can be shared with other address spaces running the program.
+//	The code segment rarely ends on a page boundary, so its last
+//	page usually holds some data too.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsText(int vpn)
+{
+    int pageStart = vpn * PageSize;
+    int pageEnd = pageStart + PageSize;
+    Segment *segs[2];
+
+    if ((noffHeader.code.size <= 0) 
+	    || (pageStart < noffHeader.code.virtualAddr)
+	    || (pageEnd > noffHeader.code.virtualAddr + noffHeader.code.size))
+	return FALSE;
+    segs[0] = &noffHeader.initData;
+    segs[1] = &noffHeader.uninitData;
+    for (int i = 0; i < 2; i++)
+	if ((segs[i]->size > 0) && (segs[i]->virtualAddr < pageEnd)
+		&& (segs[i]->virtualAddr + segs[i]->size > pageStart))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill page frame "frame" with the contents of virtual page "vpn",
+//	and map it.  If we have saved the page, read it from the backing
+//	store; otherwise, read whatever parts of the code and initialized
+//	data segments fall on the page from the executable, and zero the
+//	rest.  A page of uninitialized data or stack is just zeroed.
+//
+//	"vpn" -- the virtual page to load
+//	"frame" -- the physical page frame to load it into
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPage(int vpn, int frame)
+{
+    char *page = &(machine->mainMemory[frame * PageSize]);
+    int pageStart = vpn * PageSize;
+    Segment *segs[2];
+    int start, end;
+
+    if (backingStore->Holds(vpn))
+	backingStore->PageIn(vpn, page);
+    else if (!FromExecutable(&noffHeader, vpn)) {
+	DEBUG('v', "Zero-filling page %d\n", vpn);
+	stats->numZeroFillFaults++;
+	bzero(page, PageSize);
+    } else {
+	bzero(page, PageSize);
+	segs[0] = &noffHeader.code;
+	segs[1] = &noffHeader.initData;
+	for (int i = 0; i < 2; i++) {
+	    if (segs[i]->size <= 0)
+		continue;
+	    start = max(segs[i]->virtualAddr, pageStart);
+	    end = min(segs[i]->virtualAddr + segs[i]->size, 
+			pageStart + PageSize);
+	    if (start < end)
+		execFile->ReadAt(&page[start - pageStart], end - start,
+			segs[i]->inFileAddr + (start - segs[i]->virtualAddr));
+	}
+    }
+    machine->InvalidateDecodePage(frame);	// the frame has new contents
+    MapPage(vpn, frame);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapPage
+// 	Map virtual page "vpn" to page frame "frame", which holds its
+//	contents: either we just loaded them, or the frame is a page of
+//	text shared with another address space.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::MapPage(int vpn, int frame)
+{
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = TRUE;		// it's about to be used
+    pageTable[vpn].dirty = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Remove virtual page "vpn" from memory, because the frame table 
+//	needs its frame for something else.  If the page has been changed
+//	since it was brought in, save it in the backing store.
+//
+//	The TLB may hold the page's translation (and its latest dirty
+//	bit), so we have to take it out first.
+//
+//	"vpn" -- the virtual page to evict
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageOut(int vpn)
+{
+    TranslationEntry *pte = &pageTable[vpn];
+
+    ASSERT(pte->valid);
+    DropTLBEntry(vpn);
+    pte->valid = FALSE;
+    machine->FlushTranslationCache();
+    if (pte->dirty) {
+	stats->numPageWritebacks++;
+	backingStore->PageOut(vpn, 
+		&(machine->mainMemory[pte->physicalPage * PageSize]));
+    }
+    pte->physicalPage = -1;
+    if (cow[vpn]) {			// when it comes back, it will
+	cow[vpn] = FALSE;		// be our own copy
+	pte->readOnly = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandleReadOnly
+// 	Handle a write to a read-only page.  If the page is shared
+//	copy-on-write, have the frame table give us a writable copy;
+//	the faulting instruction is then re-executed.
+//
+//	Returns FALSE if "badVAddr" is outside the address space, or
+//	the page really is read-only.
+//
+//	"badVAddr" -- the virtual address that was written
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandleReadOnly(int badVAddr)
+{
+    unsigned int vpn = (unsigned) badVAddr / PageSize;
+
+    if ((vpn >= numPages) || !cow[vpn])
+	return FALSE;
+    DEBUG('v', "Write to copy-on-write page %d\n", vpn);
+    frameTable->CopyOnWrite(this, vpn);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MakeWritable
+// 	Map virtual page "vpn" to "frame", which now holds our own copy
+//	of the page, and let the program write it.  The old read-only
+//	translation may still be in the TLB, or the machine's translation
+//	cache, so take it out.
+//
+//	"vpn" -- the page that was copy-on-write
+//	"frame" -- where our copy of it is
+//----------------------------------------------------------------------
+
+void
+AddrSpace::MakeWritable(int vpn, int frame)
+{
+    TranslationEntry *pte = &pageTable[vpn];
+
+    DropTLBEntry(vpn);
+    pte->physicalPage = frame;
+    pte->readOnly = FALSE;
+    pte->use = TRUE;
+    cow[vpn] = FALSE;
+    machine->FlushTranslationCache();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::DropTLBEntry
+// 	If we are the running address space, the TLB may hold the 
+//	translation for "vpn" (and its latest use and dirty bits); copy 
+//	the bits back to our page table and invalidate the entry.  Other
+//	address spaces have nothing in the TLB.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::DropTLBEntry(int vpn)
+{
+    if ((machine->tlb == NULL) || (currentThread->space != this))
+	return;
+    for (int i = 0; i < machine->tlbSize; i++)
+	if (machine->tlb[i].valid && (machine->tlb[i].virtualPage == vpn)) {
+	    SyncTLBEntry(&machine->tlb[i]);
+	    machine->tlb[i].valid = FALSE;
+	}
+}
+#endif
@@ -15,6 +15,10 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "noff.h"
+#ifdef VM
+#include "backingstore.h"
+#endif
 
 #define UserStackSize		1024 	// increase this as necessary!
 
@@ -22,7 +26,13 @@ class AddrSpace {
   public:
     AddrSpace(OpenFile *executable);	// Create an address space,
 					// initializing it with the program
-					// stored in the file "executable"
+					// stored in the file "executable".
+					// With VM, the address space keeps
+					// (and eventually deletes) the file
+#ifdef VM
+    AddrSpace(AddrSpace *parent);	// Create a copy of "parent", sharing
+					// its pages copy-on-write (for Fork)
+#endif
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -31,11 +41,56 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    bool TLBRefill(int badVAddr);	// Load the translation for a virtual
+					// address into the TLB; FALSE if 
+					// the address isn't mapped
+    void SyncTLB();			// Copy use and dirty bits from the
+					// TLB into our page table
+    TranslationEntry *PageEntry(int vpn) { return &pageTable[vpn]; }
+					// The page table entry for "vpn"
+
+    bool HandlePageFault(int badVAddr);	// Bring in (or zero-fill) a page 
+					// that isn't in memory; FALSE if the
+					// address isn't part of the address
+					// space
+    bool ReadByte(int virtAddr, char *value);
+					// Copy a byte in from user memory,
+					// for a system call; FALSE if the
+					// address isn't part of the space
+#ifdef VM
+    void LoadPage(int vpn, int frame);	// Read page "vpn" into "frame"
+    void MapPage(int vpn, int frame);	// Map "vpn" to "frame", which 
+					// already holds it
+    void PageOut(int vpn);		// Evict page "vpn" from memory
+					// (these two called by the frame table)
+    bool HandleReadOnly(int badVAddr);	// Handle a write to a copy-on-write
+					// page; FALSE if it's really read-only
+    void MakeWritable(int vpn, int frame);
+					// Map "vpn", now our own copy, in
+					// "frame" (called by the frame table)
+#endif
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+
+    void SyncTLBEntry(TranslationEntry *entry);
+					// Copy the use and dirty bits of a
+					// TLB entry back to the page table
+
+#ifdef VM
+    OpenFile *execFile;			// where to find code and data pages
+    int *execRefs;			// # of address spaces sharing execFile
+    NoffHeader noffHeader;		// where they are in the file
+    int textFile;			// which executable, for sharing text
+    BackingStore *backingStore;		// where to find pages we evicted
+    bool *cow;				// which pages are shared copy-on-write
+
+    void DropTLBEntry(int vpn);		// Take "vpn" out of the TLB
+    bool IsText(int vpn);		// Does "vpn" hold nothing but code?
+#endif
 };
 
 #endif // ADDRSPACE_H
@@ -4,8 +4,8 @@
 //	transfer back to here from user code:
 //
 //	syscall -- The user code explicitly requests to call a procedure
-//	in the Nachos kernel.  Right now, the only function we support is
-//	"Halt".
+//	in the Nachos kernel.  Right now, we support "Halt" and 
+//	"SetTickets", and with virtual memory, "Exit", "Exec" and "Fork".
 //
 //	exceptions -- The user code does something that the CPU can't handle.
 //	For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,7 +14,8 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
+// For now, this only handles the system calls above, page faults,
+// and the copy-on-write faults of virtual memory.
 // Everything else core dumps.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -25,6 +26,149 @@
 #include "system.h"
 #include "syscall.h"
 
+#define MaxExecNameLen	100	// longest file name Exec will read
+
+#ifdef VM
+//----------------------------------------------------------------------
+// ForkedUserThread
+// 	The first thing run by a thread created by the Fork system call.
+//	Its registers are a copy of its parent's; start it running user
+//	code at the procedure passed to Fork, in its own address space.
+//
+//	"func" is the user-level procedure to call
+//----------------------------------------------------------------------
+
+static void
+ForkedUserThread(int func)
+{
+    currentThread->RestoreUserState();
+    machine->WriteRegister(PCReg, func);
+    machine->WriteRegister(NextPCReg, func + 4);
+    currentThread->space->RestoreState();
+    machine->Run();			// never returns; the thread
+    ASSERT(FALSE);			// exits by calling Exit
+}
+
+//----------------------------------------------------------------------
+// ForkUserThread
+// 	Handle the Fork system call: create a thread running "func" in
+//	a copy-on-write copy of the current address space.
+//----------------------------------------------------------------------
+
+static void
+ForkUserThread(int func)
+{
+    Thread *t = new Thread("forked");
+
+    t->space = new AddrSpace(currentThread->space);
+    t->SaveUserState();			// start from a copy of our registers
+    t->Fork(ForkedUserThread, (void *) func);
+}
+
+//----------------------------------------------------------------------
+// ExecedUserThread
+// 	The first thing run by a thread created by the Exec system call:
+//	start running the new program from the beginning.
+//----------------------------------------------------------------------
+
+static void
+ExecedUserThread(int dummy)
+{
+    currentThread->space->InitRegisters();
+    currentThread->space->RestoreState();
+    machine->Run();			// never returns; the thread
+    ASSERT(FALSE);			// exits by calling Exit
+}
+
+//----------------------------------------------------------------------
+// CopyInString
+// 	Copy a null-terminated string in from the current address space,
+//	a byte at a time, for a system call.  Strings longer than
+//	"maxLen" are cut short.  Returns FALSE if any byte of it isn't
+//	part of the address space.
+//
+//	"from" -- the user virtual address of the string
+//	"to" -- where to put it; room for "maxLen" + 1 bytes
+//----------------------------------------------------------------------
+
+static bool
+CopyInString(int from, char *to, int maxLen)
+{
+    int i;
+
+    for (i = 0; i < maxLen; i++) {
+	if (!currentThread->space->ReadByte(from + i, &to[i]))
+	    return FALSE;
+	if (to[i] == '\0')
+	    return TRUE;
+    }
+    to[i] = '\0';
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ExecUserProgram
+// 	Handle the Exec system call: run the program in the Nachos file
+//	named by the string at "nameAddr" in user memory, in a new thread
+//	and address space.  Returns its address space identifier, or -1 if
+//	the name isn't in the caller's address space or the file can't be
+//	opened.
+//----------------------------------------------------------------------
+
+static int
+ExecUserProgram(int nameAddr)
+{
+    static int nextSpaceId = 0;
+    char name[MaxExecNameLen + 1];
+    OpenFile *executable;
+    Thread *t;
+
+    if (!CopyInString(nameAddr, name, MaxExecNameLen)) {
+	DEBUG('a', "Exec: bad file name address 0x%x\n", nameAddr);
+	return -1;
+    }
+    executable = fileSystem->Open(name);
+    if (executable == NULL) {
+	DEBUG('a', "Exec: unable to open file %s\n", name);
+	return -1;
+    }
+    t = new Thread("exec");
+    t->space = new AddrSpace(executable);
+    t->Fork(ExecedUserThread, 0);
+    return ++nextSpaceId;
+}
+#endif
+
+//----------------------------------------------------------------------
+// SetUserTickets
+// 	Handle the SetTickets system call: change the running thread's
+//	share of the CPU.  Ignore numbers of tickets out of range.
+//----------------------------------------------------------------------
+
+static void
+SetUserTickets(int tickets)
+{
+    if ((tickets < 1) || (tickets > MaxTickets)) {
+	DEBUG('a', "SetTickets: %d tickets out of range\n", tickets);
+	return;
+    }
+    currentThread->setTickets(tickets);
+}
+
+//----------------------------------------------------------------------
+// AdvancePC
+// 	Move on to the instruction after a system call, so that we don't
+//	make the same system call again when we return to user code.
+//----------------------------------------------------------------------
+
+static void
+AdvancePC()
+{
+    machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+    machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+    machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg) + 4);
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -53,9 +197,54 @@ ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
 
-    if ((which == SyscallException) && (type == SC_Halt)) {
-	DEBUG('a', "Shutdown, initiated by user program.\n");
-   	interrupt->Halt();
+    if (which == SyscallException) {
+	switch (type) {
+	  case SC_Halt:
+	    DEBUG('a', "Shutdown, initiated by user program.\n");
+#ifdef FILESYS
+	    synchDisk->Sync();
+#endif
+	    interrupt->Halt();
+	    break;
+#ifdef VM
+	  case SC_Exit:
+	    DEBUG('a', "User program exit, status %d\n", 
+			machine->ReadRegister(4));
+	    delete currentThread->space;
+	    currentThread->space = NULL;
+	    currentThread->Finish();
+	    break;
+	  case SC_Exec:
+	    machine->WriteRegister(2, 
+			ExecUserProgram(machine->ReadRegister(4)));
+	    AdvancePC();
+	    break;
+	  case SC_Fork:
+	    ForkUserThread(machine->ReadRegister(4));
+	    AdvancePC();
+	    break;
+#endif
+	  case SC_SetTickets:
+	    SetUserTickets(machine->ReadRegister(4));
+	    AdvancePC();
+	    break;
+	  default:
+	    printf("Unexpected system call %d\n", type);
+	    ASSERT(FALSE);
+	}
+    } else if ((which == PageFaultException) && (machine->tlb != NULL) &&
+	currentThread->space->TLBRefill(machine->ReadRegister(BadVAddrReg))) {
+	// just a TLB miss; the instruction will be re-executed
+    } else if ((which == PageFaultException) && 
+	currentThread->space->HandlePageFault(
+				machine->ReadRegister(BadVAddrReg))) {
+	// the page is now in memory; re-execute the instruction
+#ifdef VM
+    } else if ((which == ReadOnlyException) && 
+	currentThread->space->HandleReadOnly(
+				machine->ReadRegister(BadVAddrReg))) {
+	// we now have our own, writable copy of the page
+#endif
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
@@ -33,7 +33,10 @@ StartProcess(char *filename)
     space = new AddrSpace(executable);    
     currentThread->space = space;
 
+#ifndef VM
     delete executable;			// close file
+#endif					// else the address space needs it,
+					// to load pages on demand
 
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
@@ -71,8 +74,8 @@ ConsoleTest (char *in, char *out)
     char ch;
 
     console = new Console(in, out, ReadAvail, WriteDone, 0);
-    readAvail = new Semaphore("read avail", 0);
-    writeDone = new Semaphore("write done", 0);
+    readAvail = new Semaphore("read avail", 0, BlockedOnConsole);
+    writeDone = new Semaphore("write done", 0, BlockedOnConsole);
     
     for (;;) {
 	readAvail->P();		// wait for character to arrive
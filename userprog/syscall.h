@@ -29,6 +29,7 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_SetTickets	11
 
 #ifndef IN_ASM
 
@@ -116,6 +117,10 @@ void Close(OpenFileId id);
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
  * as the current thread.
+ *
+ * With virtual memory, the new thread instead gets its own copy of the
+ * address space, shared copy-on-write with the caller's until either one
+ * writes to a page.  "func" should end by calling Exit.
  */
 void Fork(void (*func)());
 
@@ -124,6 +129,11 @@ void Fork(void (*func)());
  */
 void Yield();		
 
+/* Set the calling thread's share of the CPU, for the stride and lottery
+ * schedulers: the number of tickets it holds, from 1 to 10000.
+ */
+void SetTickets(int tickets);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -0,0 +1,108 @@
+// backingstore.cc
+//	Routines to save pages of an address space in a swap file,
+//	and read them back in.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "backingstore.h"
+
+static int nextSwapFile = 0;		// to give each swap file its own name
+
+//----------------------------------------------------------------------
+// BackingStore::BackingStore
+// 	Initialize the backing store for an address space.  No page
+//	has been saved yet, so we don't need a swap file yet.
+//
+//	"pages" -- the number of pages in the address space
+//----------------------------------------------------------------------
+
+BackingStore::BackingStore(int pages)
+{
+    numPages = pages;
+    saved = new bool[numPages];
+    for (int i = 0; i < numPages; i++)
+	saved[i] = FALSE;
+    sprintf(name, "SWAP.%d", nextSwapFile++);
+    file = NULL;
+}
+
+//----------------------------------------------------------------------
+// BackingStore::~BackingStore
+// 	Throw away the swap file, since the address space is going away.
+//----------------------------------------------------------------------
+
+BackingStore::~BackingStore()
+{
+    if (file != NULL) {
+	delete file;
+	fileSystem->Remove(name);
+    }
+    delete [] saved;
+}
+
+//----------------------------------------------------------------------
+// BackingStore::PageOut
+// 	Write page "vpn" of the address space to the swap file, creating
+//	the file if this is the first page we have had to save.
+//
+//	"vpn" -- the virtual page being saved
+//	"from" -- where the contents of the page are in memory
+//----------------------------------------------------------------------
+
+void
+BackingStore::PageOut(int vpn, char *from)
+{
+    ASSERT((vpn >= 0) && (vpn < numPages));
+    if (file == NULL) {
+	DEBUG('v', "Creating swap file %s, %d pages\n", name, numPages);
+	if (!fileSystem->Create(name, numPages * PageSize)) {
+	    printf("Unable to create swap file %s\n", name);
+	    ASSERT(FALSE);
+	}
+	file = fileSystem->Open(name);
+	ASSERT(file != NULL);
+    }
+    DEBUG('v', "Saving page %d to %s\n", vpn, name);
+    file->WriteAt(from, PageSize, vpn * PageSize);
+    saved[vpn] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// BackingStore::PageIn
+// 	Read page "vpn" of the address space back from the swap file.
+//	The page must have been saved.
+//
+//	"vpn" -- the virtual page being read
+//	"into" -- where to put its contents in memory
+//----------------------------------------------------------------------
+
+void
+BackingStore::PageIn(int vpn, char *into)
+{
+    ASSERT(Holds(vpn) && (file != NULL));
+    DEBUG('v', "Reading page %d from %s\n", vpn, name);
+    file->ReadAt(into, PageSize, vpn * PageSize);
+}
+
+//----------------------------------------------------------------------
+// BackingStore::CopyPage
+// 	Save a copy of page "vpn" from another backing store, which must
+//	hold it.  Used when forking an address space, for the pages of
+//	the parent that are out of memory.
+//
+//	"from" -- the backing store of the parent address space
+//	"vpn" -- the virtual page to copy
+//----------------------------------------------------------------------
+
+void
+BackingStore::CopyPage(BackingStore *from, int vpn)
+{
+    char buffer[PageSize];
+
+    from->PageIn(vpn, buffer);
+    PageOut(vpn, buffer);
+}
@@ -0,0 +1,43 @@
+// backingstore.h
+//	Data structures for keeping the pages of an address space on
+//	disk, while they are not in physical memory.
+//
+//	Each address space gets its own swap file in the Nachos file
+//	system, with room for every page of the address space.  We only
+//	create it the first time a page has to be written out; a page
+//	that has never been written out is instead reloaded from the
+//	executable, or zero-filled.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BACKINGSTORE_H
+#define BACKINGSTORE_H
+
+#include "copyright.h"
+#include "filesys.h"
+
+class BackingStore {
+  public:
+    BackingStore(int pages);		// Initialize an (empty) backing
+					// store for an address space
+    ~BackingStore();			// Remove the swap file, if any
+
+    void PageOut(int vpn, char *from);	// Save page "vpn", from memory
+					// at "from"
+    void PageIn(int vpn, char *into);	// Read page "vpn" back into memory
+    bool Holds(int vpn) { return saved[vpn]; }
+					// Has page "vpn" been saved?
+    void CopyPage(BackingStore *from, int vpn);
+					// Save a copy of the page "vpn" that
+					// "from" holds (for Fork)
+
+  private:
+    int numPages;			// # of pages in the address space
+    bool *saved;			// which pages have been saved
+    char name[20];			// name of the swap file
+    OpenFile *file;			// the swap file, NULL until needed
+};
+
+#endif // BACKINGSTORE_H
@@ -0,0 +1,286 @@
+// frametable.cc
+//	Routines to manage the page frames of physical memory.
+//	See frametable.h for an overview.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "frametable.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table.  All of physical memory starts out free.
+//
+//	"policy" -- how to choose pages to evict
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(ReplacementType policy)
+{
+    for (int i = 0; i < NumPhysPages; i++) {
+	frames[i].owner = NULL;
+	frames[i].vpn = -1;
+	frames[i].sharers = NULL;
+	frames[i].refCount = 0;
+	frames[i].textFile = -1;
+    }
+    replacer = new ReplacementPolicy(policy, frames, NumPhysPages);
+    mutex = new Semaphore("frame table", 1);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable()
+{
+    FrameMapping *m;
+
+    for (int i = 0; i < NumPhysPages; i++)
+	while (frames[i].sharers != NULL) {
+	    m = frames[i].sharers;
+	    frames[i].sharers = m->next;
+	    delete m;
+	}
+    delete replacer;
+    delete mutex;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Acquire, FrameTable::Release
+// 	Get (and give back) exclusive use of the frame table, for an
+//	operation that changes many mappings, such as Fork.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Acquire()
+{
+    mutex->P();
+}
+
+void
+FrameTable::Release()
+{
+    mutex->V();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PageIn
+// 	Handle a page fault: bring page "vpn" of address space "space"
+//	into memory.  Use a free frame if there is one; otherwise, evict
+//	some other page (perhaps one of our own).
+//
+//	If the page is read-only program text, another address space
+//	running the same executable may have it in memory already; if
+//	so, we share its frame instead.
+//
+//	Returns the frame the page was loaded into.
+//
+//	"space" -- the address space that faulted
+//	"vpn" -- the virtual page that isn't in memory
+//	"textFile" -- the executable the page of text is from (see 
+//		OpenFile::FileId), or -1 if the page can't be shared
+//----------------------------------------------------------------------
+
+int
+FrameTable::PageIn(AddrSpace *space, int vpn, int textFile)
+{
+    int frame;
+
+    mutex->P();
+    if (textFile >= 0) {
+	frame = FindText(textFile, vpn);
+	if (frame >= 0) {
+	    DEBUG('v', "Sharing text page %d in frame %d\n", vpn, frame);
+	    stats->numTextShares++;
+	    Share(frame, space, vpn);
+	    space->MapPage(vpn, frame);
+	    mutex->V();
+	    return frame;
+	}
+    }
+    frame = GetFrame();
+    frames[frame].owner = space;
+    frames[frame].vpn = vpn;
+    frames[frame].refCount = 1;
+    frames[frame].textFile = textFile;
+    DEBUG('v', "Loading page %d into frame %d\n", vpn, frame);
+    space->LoadPage(vpn, frame);
+    replacer->Loaded(frame);
+    mutex->V();
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::CopyOnWrite
+// 	Handle a write to a copy-on-write page: page "vpn" of "space".
+//	If other address spaces still share the frame, copy it to a frame
+//	of our own.  Either way, the page then becomes writable.
+//
+//	We copy the page aside before looking for a new frame, since
+//	finding one might evict the frame we are copying.
+//
+//	"space" -- the address space that tried to write the page
+//	"vpn" -- the virtual page it tried to write
+//----------------------------------------------------------------------
+
+void
+FrameTable::CopyOnWrite(AddrSpace *space, int vpn)
+{
+    char buffer[PageSize];
+    int frame, copy;
+
+    mutex->P();
+    frame = space->PageEntry(vpn)->physicalPage;
+    ASSERT((frame >= 0) && (frames[frame].refCount > 0));
+    stats->numCOWFaults++;
+    if (frames[frame].refCount > 1) {
+	bcopy(&(machine->mainMemory[frame * PageSize]), buffer, PageSize);
+	Unmap(frame, space);
+	copy = GetFrame();
+	frames[copy].owner = space;
+	frames[copy].vpn = vpn;
+	frames[copy].refCount = 1;
+	frames[copy].textFile = -1;
+	bcopy(buffer, &(machine->mainMemory[copy * PageSize]), PageSize);
+	machine->InvalidateDecodePage(copy);
+	replacer->Loaded(copy);
+	DEBUG('v', "Copied shared frame %d to frame %d\n", frame, copy);
+	stats->numCOWCopies++;
+	frame = copy;
+    }
+    space->MakeWritable(vpn, frame);
+    mutex->V();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share
+// 	Map "frame" into address space "space", at virtual page "vpn",
+//	as well as wherever it is mapped already.  The caller is
+//	responsible for making the mappings read-only.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Share(int frame, AddrSpace *space, int vpn)
+{
+    FrameMapping *m = new FrameMapping;
+
+    ASSERT(frames[frame].owner != NULL);
+    m->space = space;
+    m->vpn = vpn;
+    m->next = frames[frame].sharers;
+    frames[frame].sharers = m;
+    frames[frame].refCount++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FreeFrames
+// 	Release every frame belonging to "space", because the address
+//	space is being deleted.  Its pages don't need to be saved.
+//	Frames it shares with others stay in memory for them.
+//----------------------------------------------------------------------
+
+void
+FrameTable::FreeFrames(AddrSpace *space)
+{
+    mutex->P();
+    for (int i = 0; i < NumPhysPages; i++)
+	if (frames[i].owner != NULL)
+	    Unmap(i, space);
+    mutex->V();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::GetFrame
+// 	Return a free frame.  If there isn't one, ask the replacement
+//	policy for a victim, and evict its page from every address space
+//	that maps it.
+//----------------------------------------------------------------------
+
+int
+FrameTable::GetFrame()
+{
+    FrameMapping *m;
+    int frame;
+
+    for (frame = 0; frame < NumPhysPages; frame++)
+	if (frames[frame].owner == NULL)
+	    return frame;
+
+    if (currentThread->space != NULL)
+	currentThread->space->SyncTLB();	// so the policy sees the
+						// latest use and dirty bits
+    frame = replacer->Victim();
+    DEBUG('v', "Evicting page %d from frame %d\n", frames[frame].vpn, frame);
+    stats->numPageEvictions++;
+    frames[frame].owner->PageOut(frames[frame].vpn);
+    while (frames[frame].sharers != NULL) {
+	m = frames[frame].sharers;
+	frames[frame].sharers = m->next;
+	m->space->PageOut(m->vpn);
+	delete m;
+    }
+    frames[frame].owner = NULL;
+    frames[frame].vpn = -1;
+    frames[frame].refCount = 0;
+    frames[frame].textFile = -1;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindText
+// 	Return the frame holding page "vpn" of the text of executable
+//	"textFile", or -1 if it isn't in memory.  Every address space 
+//	running the executable has its text at the same virtual pages.
+//----------------------------------------------------------------------
+
+int
+FrameTable::FindText(int textFile, int vpn)
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	if ((frames[i].textFile == textFile) && (frames[i].vpn == vpn))
+	    return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Unmap
+// 	Remove the mapping of "frame" by "space", if any.  If "space"
+//	was the owner, one of the sharers takes over; if there are no
+//	sharers, the frame becomes free.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Unmap(int frame, AddrSpace *space)
+{
+    FrameEntry *f = &frames[frame];
+    FrameMapping **mp, *m;
+
+    if (f->owner == space) {
+	if (f->sharers == NULL) {
+	    f->owner = NULL;
+	    f->vpn = -1;
+	    f->textFile = -1;
+	} else {
+	    m = f->sharers;
+	    f->owner = m->space;
+	    f->vpn = m->vpn;
+	    f->sharers = m->next;
+	    delete m;
+	}
+	f->refCount--;
+	return;
+    }
+    for (mp = &f->sharers; *mp != NULL; mp = &(*mp)->next)
+	if ((*mp)->space == space) {
+	    m = *mp;
+	    *mp = m->next;
+	    delete m;
+	    f->refCount--;
+	    return;
+	}
+}
@@ -0,0 +1,97 @@
+// frametable.h
+//	Data structures to keep track of what is in each page frame
+//	of physical memory, for demand paging.
+//
+//	When a user program touches a page that is not in memory, the
+//	frame table finds a free frame for it; if there are none, the
+//	replacement policy picks a page to evict, and its address space
+//	saves it to the backing store if it has been modified.
+//
+//	A frame can be mapped by more than one address space: after a
+//	Fork, parent and child share every page in memory, copy-on-write.
+//	The frame table counts the mappings of each frame, so that the
+//	first write to a shared page can be given its own copy, and so
+//	that evicting a shared frame takes it away from every sharer.
+//
+//	Pages of program text are shared as well, read-only, between all
+//	the address spaces running the same executable: the frame table
+//	remembers which file each text page came from, so that a page
+//	fault on the same page of the same file can just map that frame.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "synch.h"
+#include "replacement.h"
+
+class AddrSpace;
+
+// The following class defines one extra mapping of a shared frame.
+
+class FrameMapping {
+  public:
+    AddrSpace *space;		// the address space sharing the frame
+    int vpn;			// where it maps the frame
+    FrameMapping *next;		// the next sharer
+};
+
+// The following class defines the contents of a page frame.
+
+class FrameEntry {
+  public:
+    AddrSpace *owner;		// the (first) address space using the
+				// frame; NULL if the frame is free
+    int vpn;			// the virtual page it holds
+    FrameMapping *sharers;	// any other address spaces mapping it
+    int refCount;		// total # of address spaces mapping it
+    int textFile;		// if it holds a page of program text,
+				// the executable it came from; else -1
+};
+
+// The following class defines the physical memory map.
+
+class FrameTable {
+  public:
+    FrameTable(ReplacementType policy);
+				// Initialize an empty frame table,
+				// replacing pages according to "policy"
+    ~FrameTable();		// De-allocate it
+
+    int PageIn(AddrSpace *space, int vpn, int textFile);
+				// Bring page "vpn" of "space" into a
+				// frame, and return the frame #; if the
+				// page is text from file "textFile",
+				// it may already be in memory
+    void CopyOnWrite(AddrSpace *space, int vpn);
+				// Give "space" its own, writable copy of
+				// shared page "vpn"
+    void FreeFrames(AddrSpace *space);
+				// Release all of the frames used by "space"
+
+    void Acquire();		// Keep out page faults, eg, while forking
+    void Release();		// an address space
+    void Share(int frame, AddrSpace *space, int vpn);
+				// Map "frame" into "space" as well; the
+				// caller must have done Acquire
+
+  private:
+    FrameEntry frames[NumPhysPages];
+    ReplacementPolicy *replacer; // picks pages to evict
+    Semaphore *mutex;		// only one page fault at a time; the
+				// frame table is inconsistent while we
+				// wait for the disk
+
+    int GetFrame();		// Find a free frame, evicting if need be
+    int FindText(int textFile, int vpn);
+				// Find page "vpn" of "textFile"'s text
+    void Unmap(int frame, AddrSpace *space);
+				// Remove "space"'s mapping of "frame"
+};
+
+#endif // FRAMETABLE_H
@@ -0,0 +1,265 @@
+// replacement.cc
+//	Routines implementing the page replacement policies.
+//	See replacement.h for an overview.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "replacement.h"
+#include "frametable.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::ReplacementPolicy
+// 	Initialize the state for a page replacement policy.
+//
+//	"policy" -- which policy to use
+//	"frameMap" -- the frame table's record of what is in each frame
+//	"num" -- the number of frames
+//----------------------------------------------------------------------
+
+ReplacementPolicy::ReplacementPolicy(ReplacementType policy,
+				     FrameEntry *frameMap, int num)
+{
+    kind = policy;
+    frames = frameMap;
+    numFrames = num;
+    loadTime = new int[numFrames];
+    age = new unsigned char[numFrames];
+    lastUse = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	loadTime[i] = 0;
+	age[i] = 0;
+	lastUse[i] = 0;
+    }
+    numLoads = 0;
+    hand = 0;
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::~ReplacementPolicy
+// 	De-allocate the policy state.
+//----------------------------------------------------------------------
+
+ReplacementPolicy::~ReplacementPolicy()
+{
+    delete [] loadTime;
+    delete [] age;
+    delete [] lastUse;
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Loaded
+// 	Note that a new page has been brought into "frame".  It counts
+//	as just used, since the instruction that faulted is about to
+//	use it.
+//----------------------------------------------------------------------
+
+void
+ReplacementPolicy::Loaded(int frame)
+{
+    loadTime[frame] = ++numLoads;
+    age[frame] = 0x80;
+    lastUse[frame] = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Victim
+// 	Choose the page to evict.  Every frame must be in use.
+//----------------------------------------------------------------------
+
+int
+ReplacementPolicy::Victim()
+{
+    int victim = 0, oldest = -1;
+    int i;
+
+    switch (kind) {
+      case FifoReplacement:
+	for (i = 1; i < numFrames; i++)
+	    if (loadTime[i] < loadTime[victim])
+		victim = i;
+	return victim;
+
+      case ClockReplacement:
+	return Clock();
+
+      case EnhancedClockReplacement:
+	return EnhancedClock();
+
+      case AgingReplacement:
+	Sample();
+	for (i = 1; i < numFrames; i++)
+	    if ((age[i] < age[victim]) || ((age[i] == age[victim])
+			&& (loadTime[i] < loadTime[victim])))
+		victim = i;
+	return victim;
+
+      case WorkingSetReplacement:
+	Sample();
+	for (i = 0; i < numFrames; i++) {	// a clean page outside
+	    if ((stats->totalTicks - lastUse[i] > WorkingSetWindow)
+			&& !Entry(i)->dirty
+			&& ((oldest < 0) || (lastUse[i] < lastUse[oldest])))
+		oldest = i;
+	}
+	if (oldest >= 0)
+	    return oldest;
+	for (i = 1; i < numFrames; i++)		// else the least recently
+	    if (lastUse[i] < lastUse[victim])	// used, dirty or not
+		victim = i;
+	return victim;
+    }
+    ASSERT(FALSE);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Entry
+// 	Return the owner's page table entry for the page in "frame",
+//	which holds its dirty bit.  Sharers never write to a shared
+//	frame (text is read-only, and a write to a copy-on-write page
+//	gets its own frame), so no other entry can have it set.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+ReplacementPolicy::Entry(int frame)
+{
+    return frames[frame].owner->PageEntry(frames[frame].vpn);
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Used
+// 	Return TRUE if the page in "frame" has been used, through the
+//	owner's mapping or any sharer's, since its use bits were last
+//	cleared.
+//----------------------------------------------------------------------
+
+bool
+ReplacementPolicy::Used(int frame)
+{
+    FrameMapping *m;
+
+    if (Entry(frame)->use)
+	return TRUE;
+    for (m = frames[frame].sharers; m != NULL; m = m->next)
+	if (m->space->PageEntry(m->vpn)->use)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::ClearUse
+// 	Clear the use bit in every page table entry mapping "frame".
+//----------------------------------------------------------------------
+
+void
+ReplacementPolicy::ClearUse(int frame)
+{
+    FrameMapping *m;
+
+    Entry(frame)->use = FALSE;
+    for (m = frames[frame].sharers; m != NULL; m = m->next)
+	m->space->PageEntry(m->vpn)->use = FALSE;
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Sample
+// 	Record which pages have been used since the last page fault,
+//	and clear their use bits, for the aging and working set policies.
+//----------------------------------------------------------------------
+
+void
+ReplacementPolicy::Sample()
+{
+    for (int i = 0; i < numFrames; i++) {
+	age[i] >>= 1;
+	if (Used(i)) {
+	    age[i] |= 0x80;
+	    lastUse[i] = stats->totalTicks;
+	    ClearUse(i);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::Clock
+// 	Second chance: sweep the frames, starting where we left off,
+//	until we find a page whose use bit is clear.  Clear the use bits
+//	we pass, so that every page gets evicted by the second time
+//	around unless it is used again.
+//----------------------------------------------------------------------
+
+int
+ReplacementPolicy::Clock()
+{
+    int frame;
+
+    for (;;) {
+	frame = hand;
+	hand = (hand + 1) % numFrames;
+	if (!Used(frame))
+	    return frame;
+	ClearUse(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// ReplacementPolicy::EnhancedClock
+// 	Like Clock, but classify pages by (use, dirty).  First look for
+//	a page that is neither used nor dirty, without changing anything;
+//	then for one that is dirty but not used, clearing use bits as we
+//	go.  If neither pass finds one, every use bit is now clear, so
+//	the next time around will.
+//----------------------------------------------------------------------
+
+int
+ReplacementPolicy::EnhancedClock()
+{
+    int frame, i;
+
+    for (;;) {
+	for (i = 0; i < numFrames; i++) {
+	    frame = (hand + i) % numFrames;
+	    if (!Used(frame) && !Entry(frame)->dirty) {
+		hand = (frame + 1) % numFrames;
+		return frame;
+	    }
+	}
+	for (i = 0; i < numFrames; i++) {
+	    frame = (hand + i) % numFrames;
+	    if (!Used(frame)) {
+		hand = (frame + 1) % numFrames;
+		return frame;
+	    }
+	    ClearUse(frame);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// ReplacementNamed
+// 	Return the page replacement policy with the given name, as given
+//	on the command line.
+//----------------------------------------------------------------------
+
+ReplacementType
+ReplacementNamed(char *name)
+{
+    if (!strcmp(name, "fifo"))
+	return FifoReplacement;
+    else if (!strcmp(name, "clock"))
+	return ClockReplacement;
+    else if (!strcmp(name, "eclock"))
+	return EnhancedClockReplacement;
+    else if (!strcmp(name, "aging"))
+	return AgingReplacement;
+    else if (!strcmp(name, "wset"))
+	return WorkingSetReplacement;
+    printf("Unknown page replacement policy \"%s\"\n", name);
+    ASSERT(FALSE);
+    return FifoReplacement;
+}
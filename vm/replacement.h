@@ -0,0 +1,82 @@
+// replacement.h
+//	Data structures for choosing which page to evict from physical
+//	memory, when a page fault finds every frame in use.
+//
+//	The frame table tells the policy whenever a page is brought in
+//	(Loaded), and asks it for a victim when memory is full (Victim).
+//	Policies that look at the use and dirty bits read them from the
+//	page table entry of the page in each frame; the frame table makes
+//	sure any bits in the TLB have been copied back first.  A shared
+//	frame counts as used if any of the address spaces mapping it has
+//	used it.  We support:
+//
+//		FIFO -- evict the page brought in longest ago
+//		clock -- second chance: sweep the frames, clearing use
+//			bits, until we find a page not used since last time
+//		enhanced clock -- like clock, but prefer pages that are
+//			clean as well as unused, since they don't have to
+//			be written back
+//		aging -- approximate LRU: at every page fault, shift each
+//			page's use bit into an 8-bit history, and evict the
+//			page with the smallest history
+//		working set -- evict a page that hasn't been used within
+//			the last WorkingSetWindow ticks (preferring clean
+//			pages); if every page is in some working set, evict
+//			the one used longest ago
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include "copyright.h"
+#include "translate.h"
+
+#define WorkingSetWindow	5000	// in ticks of simulated time
+
+enum ReplacementType { FifoReplacement, ClockReplacement,
+		       EnhancedClockReplacement, AgingReplacement,
+		       WorkingSetReplacement };
+
+class FrameEntry;
+
+// The following class defines the state needed by each of the
+// replacement policies.
+
+class ReplacementPolicy {
+  public:
+    ReplacementPolicy(ReplacementType policy, FrameEntry *frameMap,
+			int num);		// Initialize the policy
+    ~ReplacementPolicy();		// De-allocate it
+
+    void Loaded(int frame);		// A new page was put in "frame"
+    int Victim();			// Return the frame to evict; every
+					// frame must be in use
+
+  private:
+    ReplacementType kind;		// which policy
+    FrameEntry *frames;			// what is in each frame
+    int numFrames;
+    int *loadTime;			// FIFO: when each page was brought in
+    int numLoads;			// counter for "loadTime"
+    int hand;				// clock: the next frame to look at
+    unsigned char *age;			// aging: recent use history
+    int *lastUse;			// working set: when last seen in use
+
+    TranslationEntry *Entry(int frame);	// The page table entry for the
+					// page in "frame"
+    bool Used(int frame);		// Has any mapping of "frame" been
+					// used since its use bits were cleared?
+    void ClearUse(int frame);		// Clear the use bit of every mapping
+    void Sample();			// Record (and clear) the use bits
+    int Clock();			// The clock algorithms
+    int EnhancedClock();
+};
+
+extern ReplacementType ReplacementNamed(char *name);
+					// Parse "fifo", "clock", "eclock",
+					// "aging" or "wset" (for -vmpolicy)
+
+#endif // REPLACEMENT_H